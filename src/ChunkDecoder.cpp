@@ -0,0 +1,291 @@
+// ChunkDecoder.cpp
+#include "ChunkDecoder.h"
+#include "Hdf5Lock.h"
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#ifdef SWIFT_GUI_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const char *filterName(int filter) {
+  switch (filter) {
+  case H5Z_FILTER_SHUFFLE:
+    return "shuffle";
+  case H5Z_FILTER_FLETCHER32:
+    return "fletcher32";
+#ifdef SWIFT_GUI_HAVE_ZLIB
+  case H5Z_FILTER_DEFLATE:
+    return "deflate";
+#endif
+  default:
+    return nullptr; // not something we can undo ourselves
+  }
+}
+
+/// Inverse of HDF5's byte shuffle for 4-byte elements.
+void unshuffle(const char *src, char *dst, size_t bytes) {
+  const size_t n = bytes / sizeof(float);
+  for (size_t b = 0; b < sizeof(float); ++b) {
+    const char *plane = src + b * n;
+    for (size_t i = 0; i < n; ++i)
+      dst[i * sizeof(float) + b] = plane[i];
+  }
+  // trailing bytes that don't make a whole element are stored as-is
+  std::memcpy(dst + n * sizeof(float), src + n * sizeof(float),
+              bytes - n * sizeof(float));
+}
+
+/// HDF5's Fletcher-32 over big-endian 16-bit words (H5_checksum_fletcher32).
+uint32_t fletcher32(const unsigned char *data, size_t bytes) {
+  uint32_t sum1 = 0, sum2 = 0;
+  for (size_t words = bytes / 2; words > 0;) {
+    // 360 words keep both sums clear of overflow before folding
+    size_t block = std::min<size_t>(words, 360);
+    words -= block;
+    for (; block > 0; --block, data += 2) {
+      sum1 += uint32_t(data[0]) << 8 | data[1];
+      sum2 += sum1;
+    }
+    sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+    sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+  }
+  if (bytes % 2) {
+    sum1 += uint32_t(*data) << 8;
+    sum2 += sum1;
+    sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+    sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+  }
+  sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+  sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+  return sum2 << 16 | sum1;
+}
+
+/**
+ * @brief Checks and strips the checksum the fletcher32 filter appends.
+ *
+ * The filter stores it little-endian.  Files from HDF5 before 1.6.3 may
+ * hold it with the bytes of each half swapped; the library accepts both,
+ * and so do we.
+ */
+bool verifyFletcher32(std::vector<char> &buf) {
+  if (buf.size() < 4)
+    return false;
+  const size_t bytes = buf.size() - 4;
+  const auto *data = reinterpret_cast<const unsigned char *>(buf.data());
+  const uint32_t stored = uint32_t(data[bytes]) |
+                          uint32_t(data[bytes + 1]) << 8 |
+                          uint32_t(data[bytes + 2]) << 16 |
+                          uint32_t(data[bytes + 3]) << 24;
+  const uint32_t sum = fletcher32(data, bytes);
+  const uint32_t swapped =
+      (sum & 0x00ff00ffu) << 8 | (sum & 0xff00ff00u) >> 8;
+  if (stored != sum && stored != swapped)
+    return false;
+  buf.resize(bytes);
+  return true;
+}
+
+} // namespace
+
+bool ChunkDecoder::attach(hid_t dsetId, const hsize_t dims[3]) {
+  detach();
+
+  hid_t dcpl = H5Dget_create_plist(dsetId);
+  if (dcpl < 0)
+    return false;
+
+  bool usable = H5Pget_layout(dcpl) == H5D_CHUNKED &&
+                H5Pget_chunk(dcpl, 3, m_chunk) == 3;
+  std::vector<int> filters;
+  QString pipeline;
+  int nfilters = usable ? H5Pget_nfilters(dcpl) : 0;
+  for (int i = 0; i < nfilters && usable; ++i) {
+    unsigned flags = 0, config = 0;
+    size_t nelmts = 0;
+    int filter = H5Pget_filter2(dcpl, unsigned(i), &flags, &nelmts, nullptr,
+                                0, nullptr, &config);
+    const char *name = filterName(filter);
+    usable = name != nullptr;
+    filters.push_back(filter);
+    pipeline += (i ? "+" : "") + QString(name ? name : "");
+  }
+
+  // what H5Dread returns for chunks that were never written
+  float fill = 0.0f;
+  H5D_fill_value_t fillDefined = H5D_FILL_VALUE_UNDEFINED;
+  if (usable && H5Pfill_value_defined(dcpl, &fillDefined) >= 0 &&
+      fillDefined != H5D_FILL_VALUE_UNDEFINED &&
+      H5Pget_fill_value(dcpl, H5T_NATIVE_FLOAT, &fill) < 0)
+    fill = 0.0f;
+  H5Pclose(dcpl);
+
+  // unfiltered chunks gain nothing from this; leave them to H5Dread
+  if (!usable || filters.empty())
+    return false;
+
+  hid_t type = H5Dget_type(dsetId);
+  bool nativeFloat = type >= 0 && H5Tequal(type, H5T_NATIVE_FLOAT) > 0;
+  if (type >= 0)
+    H5Tclose(type);
+  if (!nativeFloat)
+    return false;
+
+  m_dsetId = dsetId;
+  std::copy(dims, dims + 3, m_dims);
+  m_filters = std::move(filters);
+  m_pipeline = pipeline;
+  m_fill = fill;
+  return true;
+}
+
+void ChunkDecoder::detach() {
+  m_dsetId = -1;
+  m_filters.clear();
+  m_pipeline.clear();
+  m_fill = 0.0f;
+  m_group.clear();
+  m_groupIndex = -1;
+}
+
+bool ChunkDecoder::readFrame(int frame, float *dst, QThreadPool *pool,
+                             int threads) {
+  if (m_dsetId < 0 || frame < 0 || hsize_t(frame) >= m_dims[0])
+    return false;
+
+  const long long group = frame / (long long)m_chunk[0];
+  if (group != m_groupIndex) {
+    m_groupIndex = -1;
+    const size_t tiles1 = (m_dims[1] + m_chunk[1] - 1) / m_chunk[1];
+    const size_t tiles2 = (m_dims[2] + m_chunk[2] - 1) / m_chunk[2];
+    m_group.resize(tiles1 * tiles2);
+
+    // Raw chunk fetches are plain reads; only these need the HDF5 lock
+    {
+      QMutexLocker h5(&hdf5Mutex());
+      for (size_t t = 0; t < m_group.size(); ++t) {
+        Chunk &chunk = m_group[t];
+        chunk.offset[0] = hsize_t(group) * m_chunk[0];
+        chunk.offset[1] = hsize_t(t / tiles2) * m_chunk[1];
+        chunk.offset[2] = hsize_t(t % tiles2) * m_chunk[2];
+        chunk.ok = false;
+
+        hsize_t storage = 0;
+        if (H5Dget_chunk_storage_size(m_dsetId, chunk.offset, &storage) < 0)
+          storage = 0;
+        chunk.raw.resize(size_t(storage));
+        uint32_t mask = 0;
+        if (storage > 0 && H5Dread_chunk(m_dsetId, H5P_DEFAULT, chunk.offset,
+                                         &mask, chunk.raw.data()) < 0)
+          return false;
+        chunk.filterMask = mask;
+      }
+    }
+
+    // Decode concurrently; the calling thread takes chunks too
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+      for (size_t t = next.fetch_add(1); t < m_group.size();
+           t = next.fetch_add(1))
+        m_group[t].ok = decode(m_group[t]);
+    };
+    const int helpers =
+        pool ? std::min<int>(threads, int(m_group.size())) - 1 : 0;
+    QSemaphore done;
+    for (int i = 0; i < helpers; ++i) {
+      pool->start([&] {
+        work();
+        done.release();
+      });
+    }
+    work();
+    done.acquire(std::max(helpers, 0));
+
+    for (const Chunk &chunk : m_group) {
+      if (!chunk.ok)
+        return false;
+    }
+    m_groupIndex = group;
+  }
+
+  const int plane = int(frame - group * (long long)m_chunk[0]);
+  for (const Chunk &chunk : m_group)
+    copyPlane(chunk, plane, dst);
+  return true;
+}
+
+/**
+ * @brief Runs the filter pipeline backwards over one chunk's raw bytes.
+ *
+ * Filters whose bit is set in the chunk's filter mask were skipped when it
+ * was written and are skipped here too.  Unallocated chunks decode to the
+ * dataset's fill value, and a fletcher32 mismatch fails the chunk, both as
+ * H5Dread would.
+ */
+bool ChunkDecoder::decode(Chunk &chunk) const {
+  const size_t chunkFloats = size_t(m_chunk[0]) * m_chunk[1] * m_chunk[2];
+  const size_t chunkBytes = chunkFloats * sizeof(float);
+  chunk.decoded.resize(chunkFloats);
+  if (chunk.raw.empty()) {
+    std::fill(chunk.decoded.begin(), chunk.decoded.end(), m_fill);
+    return true;
+  }
+
+  std::vector<char> buf = std::move(chunk.raw);
+  std::vector<char> tmp;
+  chunk.raw = {};
+  for (int i = int(m_filters.size()) - 1; i >= 0; --i) {
+    if (chunk.filterMask & (1u << i))
+      continue;
+
+    switch (m_filters[i]) {
+    case H5Z_FILTER_FLETCHER32:
+      if (!verifyFletcher32(buf))
+        return false;
+      break;
+    case H5Z_FILTER_SHUFFLE:
+      tmp.resize(buf.size());
+      unshuffle(buf.data(), tmp.data(), buf.size());
+      buf.swap(tmp);
+      break;
+#ifdef SWIFT_GUI_HAVE_ZLIB
+    case H5Z_FILTER_DEFLATE: {
+      tmp.resize(chunkBytes);
+      uLongf length = uLongf(chunkBytes);
+      if (uncompress(reinterpret_cast<Bytef *>(tmp.data()), &length,
+                     reinterpret_cast<const Bytef *>(buf.data()),
+                     uLong(buf.size())) != Z_OK)
+        return false;
+      tmp.resize(length);
+      buf.swap(tmp);
+      break;
+    }
+#endif
+    default:
+      return false;
+    }
+  }
+
+  if (buf.size() != chunkBytes)
+    return false;
+  std::memcpy(chunk.decoded.data(), buf.data(), chunkBytes);
+  return true;
+}
+
+/// Copies the part of @p plane of @p chunk that lies inside the dataset.
+void ChunkDecoder::copyPlane(const Chunk &chunk, int plane, float *dst) const {
+  const size_t rows =
+      std::min<hsize_t>(m_chunk[1], m_dims[1] - chunk.offset[1]);
+  const size_t cols =
+      std::min<hsize_t>(m_chunk[2], m_dims[2] - chunk.offset[2]);
+  const float *src = chunk.decoded.data() + size_t(plane) * m_chunk[1] *
+                                                m_chunk[2];
+  for (size_t r = 0; r < rows; ++r)
+    std::memcpy(dst + (chunk.offset[1] + r) * m_dims[2] + chunk.offset[2],
+                src + r * m_chunk[2], cols * sizeof(float));
+}
@@ -0,0 +1,72 @@
+// ChunkDecoder.h
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+#include <hdf5.h>
+#include <vector>
+
+class QThreadPool;
+
+/**
+ * @brief Reads compressed rotation frames with parallel filter decoding.
+ *
+ * HDF5 runs a dataset's filter pipeline serially inside H5Dread.  For
+ * datasets whose pipeline we can run ourselves (shuffle, deflate when built
+ * with zlib, fletcher32) this fetches the raw chunks a frame touches with
+ * H5Dread_chunk, which is cheap I/O, and then decodes them concurrently on
+ * a thread pool.
+ *
+ * Chunks spanning several frames are decoded once per frame group and
+ * reused for the following frames, which is what rotation asks for next.
+ */
+class ChunkDecoder {
+public:
+  /**
+   * @brief Inspect @p dsetId and decide whether this path can read it.
+   *
+   * Needs a rank-3, chunked, native-float dataset with at least one filter,
+   * all of them supported.  Caller must hold hdf5Mutex().
+   */
+  bool attach(hid_t dsetId, const hsize_t dims[3]);
+
+  /// Forget the dataset (and any decoded frame group).
+  void detach();
+
+  bool isAttached() const { return m_dsetId >= 0; }
+
+  /**
+   * @brief Decode frame @p frame into @p dst (dims[1] x dims[2] floats).
+   *
+   * Takes hdf5Mutex() only while fetching raw chunks.  Returns false if a
+   * chunk could not be read or decoded; the caller should then fall back
+   * to H5Dread.
+   */
+  bool readFrame(int frame, float *dst, QThreadPool *pool, int threads);
+
+  /// Filter pipeline in write order, e.g. "shuffle+deflate" (for logging).
+  const QString &pipeline() const { return m_pipeline; }
+
+private:
+  struct Chunk {
+    hsize_t offset[3] = {0, 0, 0};
+    std::vector<char> raw;
+    quint32 filterMask = 0;
+    std::vector<float> decoded; ///< whole chunk, all frames of the group
+    bool ok = false;
+  };
+
+  bool decode(Chunk &chunk) const;
+  void copyPlane(const Chunk &chunk, int plane, float *dst) const;
+
+  hid_t m_dsetId = -1;
+  hsize_t m_dims[3] = {0, 0, 0};
+  hsize_t m_chunk[3] = {0, 0, 0};
+  std::vector<int> m_filters; ///< H5Z filter ids in write order
+  QString m_pipeline;
+  float m_fill = 0.0f; ///< dataset fill value, for unallocated chunks
+
+  // chunks of the frame group decoded last
+  std::vector<Chunk> m_group;
+  long long m_groupIndex = -1;
+};
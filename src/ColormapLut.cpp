@@ -0,0 +1,138 @@
+// ColormapLut.cpp
+#include "ColormapLut.h"
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Stretch curves on [0, 1]; each fills the table through its own
+// instantiation of fillTable()
+struct AsinhCurve {
+  float strength;
+  float denominator;
+  explicit AsinhCurve(float s) : strength(s), denominator(std::asinh(s)) {}
+  float operator()(float t) const {
+    return std::asinh(strength * t) / denominator;
+  }
+};
+
+struct SqrtCurve {
+  float operator()(float t) const { return std::sqrt(t); }
+};
+
+struct PowerCurve {
+  float exponent;
+  float operator()(float t) const { return std::pow(t, exponent); }
+};
+
+struct LinearCurve {
+  float operator()(float t) const { return t; }
+};
+
+template <class Curve>
+void fillTable(std::vector<quint32> &table, const uint8_t (*cmap)[3],
+               size_t cmapSize, Curve curve) {
+  const int entries = int(table.size());
+  const int maxColorMapIndex = static_cast<int>(cmapSize) - 1;
+
+  for (int i = 0; i < entries; ++i) {
+    // centre of the bin this entry stands for
+    float normalizedValue = (float(i) + 0.5f) / float(entries);
+
+    float stretchedValue = std::clamp(curve(normalizedValue), 0.0f, 1.0f);
+
+    int colorMapIndex = int(stretchedValue * maxColorMapIndex + 0.5f);
+    colorMapIndex = std::clamp(colorMapIndex, 0, maxColorMapIndex);
+
+    const uint8_t *rgbTriplet = cmap[colorMapIndex];
+    table[i] = 0xff000000u | (quint32(rgbTriplet[0]) << 16) |
+               (quint32(rgbTriplet[1]) << 8) | quint32(rgbTriplet[2]);
+  }
+}
+
+} // namespace
+
+bool Stretch::parse(const QString &text, Stretch &stretch) {
+  const QStringList parts = text.trimmed().toLower().split(':');
+  const QString &name = parts[0];
+  Stretch parsed;
+  if (name == "asinh") {
+    parsed.mode = StretchMode::Asinh;
+    parsed.param = 9.0f;
+  } else if (name == "log") {
+    parsed.mode = StretchMode::Log;
+  } else if (name == "sqrt") {
+    parsed.mode = StretchMode::Sqrt;
+  } else if (name == "power") {
+    parsed.mode = StretchMode::Power;
+    parsed.param = 0.5f;
+  } else if (name == "linear") {
+    parsed.mode = StretchMode::Linear;
+  } else {
+    return false;
+  }
+
+  // only asinh and power take a parameter, and it has to be positive
+  if (parts.size() > 1) {
+    bool ok = false;
+    float param = parts[1].toFloat(&ok);
+    if (!ok || !(param > 0.0f) ||
+        (parsed.mode != StretchMode::Asinh &&
+         parsed.mode != StretchMode::Power))
+      return false;
+    parsed.param = param;
+  }
+  if (parsed.mode != StretchMode::Asinh && parsed.mode != StretchMode::Power)
+    parsed.param = 0.0f;
+  stretch = parsed;
+  return true;
+}
+
+QString Stretch::toString() const {
+  switch (mode) {
+  case StretchMode::Asinh:
+    return QString("asinh:%1").arg(param);
+  case StretchMode::Log:
+    return "log";
+  case StretchMode::Sqrt:
+    return "sqrt";
+  case StretchMode::Power:
+    return QString("power:%1").arg(param);
+  case StretchMode::Linear:
+    return "linear";
+  }
+  return QString();
+}
+
+bool ColormapLut::update(const uint8_t (*cmap)[3], size_t cmapSize,
+                         const Stretch &stretch, int entries) {
+  entries = std::clamp(entries, kMinEntries, kMaxEntries);
+  if (cmap == m_cmap && cmapSize == m_cmapSize && stretch == m_stretch &&
+      entries == size())
+    return false;
+
+  m_cmap = cmap;
+  m_cmapSize = cmapSize;
+  m_stretch = stretch;
+  m_table.assign(size_t(entries), 0xff000000u);
+  if (!cmap || cmapSize == 0)
+    return true;
+
+  switch (stretch.mode) {
+  case StretchMode::Asinh:
+    fillTable(m_table, cmap, cmapSize, AsinhCurve(stretch.param));
+    break;
+  case StretchMode::Sqrt:
+    fillTable(m_table, cmap, cmapSize, SqrtCurve());
+    break;
+  case StretchMode::Power:
+    fillTable(m_table, cmap, cmapSize, PowerCurve{stretch.param});
+    break;
+  case StretchMode::Log: // already logarithmic on the kernel's index axis
+  case StretchMode::Linear:
+    fillTable(m_table, cmap, cmapSize, LinearCurve());
+    break;
+  }
+  return true;
+}
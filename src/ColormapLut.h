@@ -0,0 +1,76 @@
+// ColormapLut.h
+#pragma once
+
+#include "RenderKernels.h"
+#include <QString>
+#include <QtGlobal>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Curve between the normalized value and the colormap.
+enum class StretchMode { Asinh, Log, Sqrt, Power, Linear };
+
+/**
+ * @brief A stretch curve and its parameter, selectable per dataset.
+ *
+ * The curve itself is baked into the ColormapLut; only Log also changes
+ * how pixels index the table (see domain()).
+ */
+struct Stretch {
+  StretchMode mode = StretchMode::Asinh;
+  float param = 9.0f; ///< asinh strength or power-law exponent
+
+  /// Axis the render kernel indexes the LUT along for this stretch.
+  IndexDomain domain() const {
+    return mode == StretchMode::Log ? IndexDomain::Log2 : IndexDomain::Linear;
+  }
+
+  /// "asinh[:strength]", "log", "sqrt", "power[:exponent]" or "linear".
+  static bool parse(const QString &text, Stretch &stretch);
+  QString toString() const;
+
+  bool operator==(const Stretch &other) const {
+    return mode == other.mode && param == other.param;
+  }
+  bool operator!=(const Stretch &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Stretch + colormap folded into one table of packed 0xffRRGGBB.
+ *
+ * Entry i holds the colour of the normalized value (i + 0.5) / size() after
+ * the stretch, so the render loop only has to subtract the lower
+ * bound, multiply by size() / range and load.  The lower/upper normalization
+ * bounds are not part of the table; they live in that scale factor, so the
+ * table is only rebuilt when the colormap, stretch or size change.
+ *
+ * For a log stretch the values are normalized on the kernel's log2 axis,
+ * so the table itself is linear there.  Each curve fills the table through
+ * its own template instantiation.
+ */
+class ColormapLut {
+public:
+  static constexpr int kMinEntries = 4096;
+  static constexpr int kMaxEntries = 65536;
+
+  /**
+   * @brief Rebuild the table if any of its inputs changed.
+   * @param cmap           [cmapSize][3] RGB table from colormaps.h
+   * @param cmapSize       Number of colormap entries
+   * @param stretch        Stretch curve
+   * @param entries        Table size, clamped to [kMinEntries, kMaxEntries]
+   * @return true if the table was rebuilt
+   */
+  bool update(const uint8_t (*cmap)[3], size_t cmapSize,
+              const Stretch &stretch, int entries);
+
+  const quint32 *data() const { return m_table.data(); }
+  int size() const { return int(m_table.size()); }
+
+private:
+  std::vector<quint32> m_table;
+  const uint8_t (*m_cmap)[3] = nullptr;
+  size_t m_cmapSize = 0;
+  Stretch m_stretch;
+};
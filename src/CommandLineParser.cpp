@@ -28,6 +28,40 @@ CommandLineParser::CommandLineParser(QCoreApplication & /*app*/)
   QCommandLineOption paramFilePathOpt(QStringList{"p", "params-file"},
                                       "Path to the parameters file.", "path");
   m_parser->addOption(paramFilePathOpt);
+  QCommandLineOption pageBufferOpt(
+      "hdf5-page-buffer",
+      "HDF5 page buffer per image file in MiB (0 = off; paged files only).",
+      "MiB", "0");
+  m_parser->addOption(pageBufferOpt);
+  QCommandLineOption scrubDecimationOpt(
+      "scrub-decimation",
+      "Coarsen frames by this factor while the knob moves (1 = off).",
+      "factor", "4");
+  m_parser->addOption(scrubDecimationOpt);
+  QCommandLineOption timingsCsvOpt(
+      "timings-csv",
+      "Append visualisation pipeline stage timings to this CSV on exit.",
+      "path");
+  m_parser->addOption(timingsCsvOpt);
+  QCommandLineOption stretchOpt(
+      "stretch",
+      "Per-dataset stretch, e.g. stars=log,gas_temperature=power:0.5 "
+      "(asinh[:strength], log, sqrt, power[:exponent], linear).",
+      "list");
+  m_parser->addOption(stretchOpt);
+  QCommandLineOption framePacksOpt(
+      "frame-packs",
+      "Transcode image files into uint16 frame packs and rotate from those "
+      "(log-quantized display values; bounds still come from the floats).");
+  m_parser->addOption(framePacksOpt);
+  QCommandLineOption benchRenderOpt(
+      "bench-render", "Time every render kernel on this machine and exit.");
+  m_parser->addOption(benchRenderOpt);
+  QCommandLineOption benchLayoutOpt(
+      "bench-layout",
+      "Time rotation reads under each HDF5 layout and chunk cache on this "
+      "machine and exit.");
+  m_parser->addOption(benchLayoutOpt);
 }
 
 void CommandLineParser::process(QCoreApplication &app) {
@@ -50,6 +84,10 @@ void CommandLineParser::process(QCoreApplication &app) {
     return;
   }
 
+  // The benchmarks need no simulation
+  if (benchRender() || benchLayout())
+    return;
+
   // Error if we haven't been handed everything we need
   if (m_simDir.isEmpty()) {
     qCritical()
@@ -104,3 +142,39 @@ QString CommandLineParser::logFilePath() const {
 QString CommandLineParser::paramFilePath() const {
   return m_parser->value("params-file");
 }
+
+qint64 CommandLineParser::hdf5PageBufferBytes() const {
+  return qint64(m_parser->value("hdf5-page-buffer").toDouble() * 1024 * 1024);
+}
+
+int CommandLineParser::scrubDecimation() const {
+  return m_parser->value("scrub-decimation").toInt();
+}
+
+QString CommandLineParser::timingsCsvPath() const {
+  return m_parser->value("timings-csv");
+}
+
+QHash<QString, QString> CommandLineParser::stretches() const {
+  QHash<QString, QString> result;
+  for (const QString &item : m_parser->value("stretch").split(',')) {
+    const QStringList pair = item.split('=');
+    if (pair.size() == 2)
+      result.insert(pair[0].trimmed(), pair[1].trimmed());
+    else if (!item.trimmed().isEmpty())
+      qWarning() << "Ignoring --stretch entry" << item;
+  }
+  return result;
+}
+
+bool CommandLineParser::framePacks() const {
+  return m_parser->isSet("frame-packs");
+}
+
+bool CommandLineParser::benchRender() const {
+  return m_parser->isSet("bench-render");
+}
+
+bool CommandLineParser::benchLayout() const {
+  return m_parser->isSet("bench-layout");
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QHash>
 #include <QString>
 
 class QCoreApplication;
@@ -27,6 +28,31 @@ public:
   /// Returns the path passed via --params-file (or the default).
   QString paramFilePath() const;
 
+  /// Returns the HDF5 page buffer size passed via --hdf5-page-buffer, in
+  /// bytes (0 = off).
+  qint64 hdf5PageBufferBytes() const;
+
+  /// Returns the extra read decimation while scrubbing, passed via
+  /// --scrub-decimation (1 = always full quality).
+  int scrubDecimation() const;
+
+  /// Returns the CSV the visualisation stage timings are appended to on
+  /// exit, passed via --timings-csv ("" = the default next to gui_data.txt).
+  QString timingsCsvPath() const;
+
+  /// Returns the per-dataset stretches passed via --stretch, as
+  /// dataset → "mode[:param]" (see Stretch::parse()).
+  QHash<QString, QString> stretches() const;
+
+  /// True if --frame-packs asked to rotate from uint16 frame packs.
+  bool framePacks() const;
+
+  /// True if --bench-render asked for the render kernel microbenchmark.
+  bool benchRender() const;
+
+  /// True if --bench-layout asked for the HDF5 layout benchmark.
+  bool benchLayout() const;
+
 private:
   QCommandLineParser *m_parser;
   QString m_simDir;
@@ -0,0 +1,97 @@
+// FrameCache.cpp
+#include "FrameCache.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+
+size_t qHash(const FrameKey &key, size_t seed) {
+  // floats hashed by bit pattern; they only ever come from the same code
+  quint32 bits[3];
+  std::memcpy(&bits[0], &key.min, sizeof(float));
+  std::memcpy(&bits[1], &key.max, sizeof(float));
+  std::memcpy(&bits[2], &key.stretch, sizeof(float));
+  return qHashMulti(seed, key.fileNumber, key.dataset, key.frameIndex,
+                    key.step, key.block, key.width, key.height, key.colormap,
+                    key.lutEntries, key.stretchMode, bits[0], bits[1],
+                    bits[2], key.packed);
+}
+
+FrameCache::FrameCache(qint64 budgetBytes)
+    : m_budget(std::max<qint64>(budgetBytes, 0)) {}
+
+void FrameCache::setBudget(qint64 bytes) {
+  QMutexLocker lock(&m_mutex);
+  m_budget = std::max<qint64>(bytes, 0);
+  evictTo(m_budget);
+}
+
+qint64 FrameCache::budget() const {
+  QMutexLocker lock(&m_mutex);
+  return m_budget;
+}
+
+qint64 FrameCache::bytes() const {
+  QMutexLocker lock(&m_mutex);
+  return m_bytes;
+}
+
+bool FrameCache::find(const FrameKey &key, QImage &out) {
+  QMutexLocker lock(&m_mutex);
+  auto it = m_index.find(key);
+  if (it == m_index.end()) {
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  m_entries.splice(m_entries.begin(), m_entries, it.value());
+  out = m_entries.front().image;
+  m_hits.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+void FrameCache::insert(const FrameKey &key, const QImage &image) {
+  qint64 size = image.sizeInBytes();
+  QMutexLocker lock(&m_mutex);
+  if (size <= 0 || size > m_budget)
+    return;
+
+  auto it = m_index.find(key);
+  if (it != m_index.end()) {
+    m_bytes -= it.value()->image.sizeInBytes();
+    m_entries.erase(it.value());
+    m_index.erase(it);
+  }
+
+  evictTo(m_budget - size);
+  m_entries.push_front({key, image});
+  m_index.insert(key, m_entries.begin());
+  m_bytes += size;
+}
+
+bool FrameCache::evictOldest() {
+  QMutexLocker lock(&m_mutex);
+  if (m_entries.empty())
+    return false;
+  evictTo(m_bytes - m_entries.back().image.sizeInBytes());
+  return true;
+}
+
+void FrameCache::clear() {
+  QMutexLocker lock(&m_mutex);
+  m_entries.clear();
+  m_index.clear();
+  m_bytes = 0;
+}
+
+/**
+ * @brief Drops least recently used frames until at most @p bytes remain.
+ * Caller must hold m_mutex.
+ */
+void FrameCache::evictTo(qint64 bytes) {
+  while (m_bytes > bytes && !m_entries.empty()) {
+    const Entry &oldest = m_entries.back();
+    m_bytes -= oldest.image.sizeInBytes();
+    m_index.remove(oldest.key);
+    m_entries.pop_back();
+    m_evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,95 @@
+// FrameCache.h
+#pragma once
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <list>
+
+/**
+ * @brief Everything a finished frame's pixels depend on.
+ */
+struct FrameKey {
+  int fileNumber = -1;
+  QString dataset;
+  int frameIndex = -1;
+  int step = 1; ///< read decimation, see RotationFrameLoader::setTargetSize()
+  int block = 1;
+  int width = 0; ///< output size, see RotationFrameLoader::setScaleToTarget()
+  int height = 0;
+  int colormap = 0;
+  int lutEntries = 0;
+  float min = 0.0f;
+  float max = 0.0f;
+  int stretchMode = 0;
+  float stretch = 0.0f; ///< stretch parameter
+  bool packed = false;  ///< decoded from a frame pack (quantized), not floats
+
+  bool operator==(const FrameKey &other) const {
+    return fileNumber == other.fileNumber && frameIndex == other.frameIndex &&
+           step == other.step && block == other.block &&
+           width == other.width && height == other.height &&
+           colormap == other.colormap && lutEntries == other.lutEntries &&
+           min == other.min && max == other.max &&
+           stretchMode == other.stretchMode && stretch == other.stretch &&
+           packed == other.packed && dataset == other.dataset;
+  }
+};
+
+size_t qHash(const FrameKey &key, size_t seed = 0);
+
+/**
+ * @brief Byte-budgeted LRU cache of rendered frames, thread-safe.
+ *
+ * Visitors scrub back and forth over the same stretch of the timeline; once
+ * the normalization is fixed, a frame they have already seen can be shown
+ * again without touching HDF5 or the colormap.  Images are stored as
+ * implicitly shared QImages, so a hit costs a reference count.
+ */
+class FrameCache {
+public:
+  explicit FrameCache(qint64 budgetBytes = 512ll * 1024 * 1024);
+
+  /// Change the byte budget (0 disables caching); evicts the excess.
+  void setBudget(qint64 bytes);
+  qint64 budget() const;
+
+  /// Look up @p key; on a hit the frame becomes most recently used.
+  bool find(const FrameKey &key, QImage &out);
+
+  /// Store a rendered frame (replacing any frame under the same key).
+  void insert(const FrameKey &key, const QImage &image);
+
+  /// Drop the least recently used frame; false if there was none.
+  bool evictOldest();
+
+  /// Drop every frame (after a normalization or colormap change).
+  void clear();
+
+  qint64 bytes() const;
+  quint64 hits() const { return m_hits.load(std::memory_order_relaxed); }
+  quint64 misses() const { return m_misses.load(std::memory_order_relaxed); }
+  quint64 evictions() const {
+    return m_evictions.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Entry {
+    FrameKey key;
+    QImage image;
+  };
+
+  void evictTo(qint64 bytes);
+
+  mutable QMutex m_mutex;
+  std::list<Entry> m_entries; // front = most recently used
+  QHash<FrameKey, std::list<Entry>::iterator> m_index;
+  qint64 m_budget;
+  qint64 m_bytes = 0;
+
+  std::atomic<quint64> m_hits{0};
+  std::atomic<quint64> m_misses{0};
+  std::atomic<quint64> m_evictions{0};
+};
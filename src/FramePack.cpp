@@ -0,0 +1,125 @@
+// FramePack.cpp
+#include "FramePack.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <cmath>
+#include <cstring>
+
+QString FramePack::packPath(const QString &hdf5Path) {
+  QString path = hdf5Path;
+  if (path.endsWith(".hdf5"))
+    path.chop(5);
+  return path + ".fpk";
+}
+
+bool FramePack::open(const QString &hdf5Path) {
+  close();
+
+  QFileInfo source(hdf5Path);
+  QFileInfo pack(packPath(hdf5Path));
+  if (!source.exists() || !pack.exists() ||
+      pack.size() < qint64(sizeof(FileHeader)))
+    return false;
+  if (!m_file.map(pack.filePath(), 0, size_t(pack.size())))
+    return false;
+
+  const char *base = static_cast<const char *>(m_file.data());
+  const size_t size = m_file.size();
+  FileHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  bool ok = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+            header.version == kVersion &&
+            header.sourceMtimeMs ==
+                source.lastModified().toMSecsSinceEpoch() &&
+            header.sourceSize == source.size() &&
+            sizeof(FileHeader) + size_t(header.datasetCount) *
+                                     sizeof(DatasetEntry) <=
+                size;
+
+  for (quint32 i = 0; ok && i < header.datasetCount; ++i) {
+    DatasetEntry entry;
+    std::memcpy(&entry,
+                base + sizeof(FileHeader) + i * sizeof(DatasetEntry),
+                sizeof(entry));
+    if (entry.frames == 0)
+      continue; // the writer gave up on this one
+
+    const size_t frames = entry.frames;
+    const size_t frameBytes = size_t(entry.xres) * entry.yres * 2;
+    if (entry.rangesOffset + frames * 2 * sizeof(float) > size ||
+        entry.dataOffset + frames * frameBytes > size || frameBytes == 0) {
+      ok = false;
+      break;
+    }
+
+    Dataset dataset;
+    dataset.name = QString::fromUtf8(
+        entry.name, int(qstrnlen(entry.name, sizeof(entry.name))));
+    dataset.frames = int(entry.frames);
+    dataset.xres = int(entry.xres);
+    dataset.yres = int(entry.yres);
+    dataset.percentileLow = entry.percentileLow;
+    dataset.percentileHigh = entry.percentileHigh;
+    dataset.lowerValue = entry.lowerValue;
+    dataset.upperValue = entry.upperValue;
+    dataset.ranges =
+        reinterpret_cast<const float *>(base + entry.rangesOffset);
+    dataset.data = reinterpret_cast<const quint16 *>(base + entry.dataOffset);
+    m_datasets.push_back(dataset);
+  }
+
+  if (!ok) {
+    close();
+    return false;
+  }
+  m_source = hdf5Path;
+  m_age = header.age;
+  m_hasAge = header.hasAge != 0;
+  return true;
+}
+
+void FramePack::close() {
+  m_file.unmap();
+  m_source.clear();
+  m_age = 0.0;
+  m_hasAge = false;
+  m_datasets.clear();
+  m_tableFrame = nullptr;
+}
+
+const FramePack::Dataset *FramePack::dataset(const QString &name) const {
+  for (const Dataset &dataset : m_datasets) {
+    if (dataset.name == name)
+      return &dataset;
+  }
+  return nullptr;
+}
+
+void FramePack::decodeFrame(const Dataset &dataset, int frame, float *dst) {
+  const size_t pixels = size_t(dataset.xres) * dataset.yres;
+  const quint16 *src = dataset.data + size_t(frame) * pixels;
+
+  // 64K exps per frame is nothing next to the per-pixel pass below
+  if (m_tableFrame != src) {
+    const float logMin = dataset.ranges[2 * frame];
+    const float logMax = dataset.ranges[2 * frame + 1];
+    const double delta = double(logMax - logMin) / (kMaxCode - 1);
+    m_table.resize(size_t(kMaxCode) + 1);
+    m_table[kEmpty] = 0.0f;
+    for (quint32 q = 1; q <= kMaxCode; ++q)
+      m_table[q] = float(std::exp(double(logMin) + (q - 1) * delta));
+    m_tableFrame = src;
+  }
+
+  const float *table = m_table.data();
+  for (size_t i = 0; i < pixels; ++i)
+    dst[i] = table[src[i]];
+}
+
+void FramePack::willNeed(const Dataset &dataset, int frame) const {
+  const size_t frameBytes = size_t(dataset.xres) * dataset.yres * 2;
+  const char *base = static_cast<const char *>(m_file.data());
+  const char *start =
+      reinterpret_cast<const char *>(dataset.data) + frame * frameBytes;
+  m_file.willNeed(size_t(start - base), frameBytes);
+}
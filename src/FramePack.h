@@ -0,0 +1,120 @@
+// FramePack.h
+#pragma once
+
+#include "MappedFile.h"
+#include <QString>
+#include <QtGlobal>
+#include <vector>
+
+/**
+ * @brief Read side of the frame-pack sidecar (image_N.fpk).
+ *
+ * A frame pack is a transcoded copy of an image file laid out for the
+ * rotation loop: every dataset is stored as [frames, x, y] uint16,
+ * log-quantized per frame, behind a small fixed header.  The file is
+ * memory mapped, so a frame is a pointer into the page cache plus one
+ * table lookup per pixel and the hot path never touches HDF5.
+ *
+ * Quantization: 0 is reserved for empty (non-positive) pixels; codes
+ * 1..kMaxCode span [logMin, logMax] of the frame's positive values, i.e. a
+ * relative step of (logMax - logMin) / 65534.
+ *
+ * Packs are written by FramePackWriter in native byte order and record the
+ * mtime and size of their image file; a pack whose image file changed
+ * since is ignored.
+ */
+class FramePack {
+public:
+  static constexpr char kMagic[8] = {'S', 'W', 'F', 'P', 'A', 'C', 'K', '\0'};
+  static constexpr quint32 kVersion = 1;
+  static constexpr quint16 kEmpty = 0;
+  static constexpr quint16 kMaxCode = 65535;
+
+  /// On-disk file header.
+  struct FileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 datasetCount;
+    qint64 sourceMtimeMs;
+    qint64 sourceSize;
+    double age;
+    quint32 hasAge;
+    quint32 reserved[3];
+  };
+  static_assert(sizeof(FileHeader) == 56, "FileHeader layout");
+
+  /// On-disk dataset entry, datasetCount of them after the header.
+  struct DatasetEntry {
+    char name[32];
+    quint32 frames; ///< 0 if the dataset could not be packed
+    quint32 xres;
+    quint32 yres;
+    quint32 reserved;
+    /// slice-0 normalization bounds for the percentile pair below
+    float percentileLow;
+    float percentileHigh;
+    float lowerValue;
+    float upperValue;
+    quint64 rangesOffset; ///< frames x {float logMin, float logMax}
+    quint64 dataOffset;   ///< page aligned, frames x xres x yres uint16
+  };
+  static_assert(sizeof(DatasetEntry) == 80, "DatasetEntry layout");
+
+  /// One packed dataset of an open pack.
+  struct Dataset {
+    QString name;
+    int frames = 0;
+    int xres = 0;
+    int yres = 0;
+    float percentileLow = 0.0f;
+    float percentileHigh = 0.0f;
+    float lowerValue = 0.0f;
+    float upperValue = 1.0f;
+    const float *ranges = nullptr;
+    const quint16 *data = nullptr;
+  };
+
+  /// Pack path for an image file: image_N.hdf5 → image_N.fpk.
+  static QString packPath(const QString &hdf5Path);
+
+  /**
+   * @brief Map the pack of @p hdf5Path, closing any open one.
+   *
+   * Fails if there is no pack, it is malformed, or the image file changed
+   * since it was written.
+   */
+  bool open(const QString &hdf5Path);
+
+  /// Unmap (no-op when nothing is open).
+  void close();
+
+  bool isOpen() const { return !m_file.isNull(); }
+  const QString &sourcePath() const { return m_source; }
+  bool hasAge() const { return m_hasAge; }
+  double age() const { return m_age; }
+
+  /// The packed dataset called @p name, or nullptr.
+  const Dataset *dataset(const QString &name) const;
+
+  /**
+   * @brief Dequantize frame @p frame of @p dataset into @p dst.
+   *
+   * The decode table is rebuilt only when the frame changes, so this is
+   * not thread-safe; the loader calls it under its state mutex.
+   */
+  void decodeFrame(const Dataset &dataset, int frame, float *dst);
+
+  /// Ask the kernel to read frame @p frame of @p dataset ahead.
+  void willNeed(const Dataset &dataset, int frame) const;
+
+private:
+  MappedFile m_file;
+  QString m_source;
+  double m_age = 0.0;
+  bool m_hasAge = false;
+  std::vector<Dataset> m_datasets;
+
+  // code → value for the frame decoded last
+  std::vector<float> m_table;
+  const quint16 *m_tableFrame = nullptr;
+};
@@ -0,0 +1,310 @@
+// FramePackWriter.cpp
+#include "FramePackWriter.h"
+#include "FramePack.h"
+#include "Hdf5Lock.h"
+#include "NormalizationCache.h"
+#include "PercentileEngine.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <hdf5.h>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// frame data starts on a page so each dataset maps cleanly
+constexpr quint64 kDataAlignment = 4096;
+
+quint64 alignUp(quint64 offset) {
+  return (offset + kDataAlignment - 1) / kDataAlignment * kDataAlignment;
+}
+
+bool packable(float value) { return value > 0.0f && std::isfinite(value); }
+
+/**
+ * @brief Log-quantizes one slice into @p dst (see FramePack).
+ *
+ * @return false if the slice holds negative values, which a log scale
+ * cannot represent; the dataset is then left to the HDF5 path.
+ */
+bool quantize(const float *src, size_t pixels, quint16 *dst, float &logMin,
+              float &logMax) {
+  float lo = std::numeric_limits<float>::max();
+  float hi = std::numeric_limits<float>::lowest();
+  for (size_t i = 0; i < pixels; ++i) {
+    if (src[i] < 0.0f)
+      return false;
+    if (packable(src[i])) {
+      float l = std::log(src[i]);
+      lo = std::min(lo, l);
+      hi = std::max(hi, l);
+    }
+  }
+
+  if (lo > hi) { // nothing but empty pixels
+    logMin = logMax = 0.0f;
+    std::fill(dst, dst + pixels, FramePack::kEmpty);
+    return true;
+  }
+
+  const float scale = hi > lo ? (FramePack::kMaxCode - 1) / (hi - lo) : 0.0f;
+  for (size_t i = 0; i < pixels; ++i) {
+    if (!packable(src[i])) {
+      dst[i] = FramePack::kEmpty;
+      continue;
+    }
+    long q = 1 + std::lround((std::log(src[i]) - lo) * scale);
+    dst[i] = quint16(std::clamp<long>(q, 1, FramePack::kMaxCode));
+  }
+  logMin = lo;
+  logMax = hi;
+  return true;
+}
+
+struct Source {
+  QString name;
+  hid_t dsetId = -1;
+  hid_t fileSpace = -1;
+  hsize_t dims[3] = {0, 0, 0};
+  FramePack::DatasetEntry entry{};
+  std::vector<float> ranges;
+};
+
+} // namespace
+
+FramePackWriter::FramePackWriter(NormalizationCache *normCache,
+                                 QObject *parent)
+    : QObject(parent), m_normCache(normCache) {}
+
+void FramePackWriter::setDirectory(const QString &imageDirectory) {
+  m_imageDirectory = imageDirectory;
+}
+
+/**
+ * @brief Writes image_<fileNumber>.fpk.
+ *
+ * The whole volume is read once, slice by slice; HDF5 is only locked while
+ * reading, so the loader waits for at most one slice read at a time.  If
+ * the image file changes while we work the pack is discarded.
+ */
+void FramePackWriter::transcode(int fileNumber) {
+  if (m_imageDirectory.isEmpty())
+    return;
+  const QString path =
+      m_imageDirectory + QString("image_%1.hdf5").arg(fileNumber);
+  {
+    FramePack existing;
+    if (existing.open(path))
+      return;
+  }
+  QFileInfo before(path);
+  if (!before.exists())
+    return;
+
+  QElapsedTimer clock;
+  clock.start();
+
+  const QHash<QString, QPair<float, float>> wanted = m_normCache->percentiles();
+  QStringList names = wanted.keys();
+  names.sort();
+
+  FramePack::FileHeader header{};
+  std::memcpy(header.magic, FramePack::kMagic, sizeof(header.magic));
+  header.version = FramePack::kVersion;
+  header.sourceMtimeMs = before.lastModified().toMSecsSinceEpoch();
+  header.sourceSize = before.size();
+
+  // open the datasets and read the age
+  std::vector<Source> sources;
+  hid_t fileId = -1;
+  {
+    QMutexLocker h5(&hdf5Mutex());
+    fileId = H5Fopen(path.toUtf8().constData(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (fileId < 0)
+      return;
+
+    hid_t rootGroup = H5Gopen2(fileId, "/", H5P_DEFAULT);
+    if (rootGroup >= 0) {
+      hid_t ageAttr = H5Aopen_name(rootGroup, "age");
+      if (ageAttr >= 0) {
+        header.hasAge =
+            H5Aread(ageAttr, H5T_NATIVE_DOUBLE, &header.age) >= 0 ? 1 : 0;
+        H5Aclose(ageAttr);
+      }
+      H5Gclose(rootGroup);
+    }
+
+    for (const QString &name : names) {
+      const QByteArray utf8 = name.toUtf8();
+      if (utf8.size() >= int(sizeof(FramePack::DatasetEntry::name)))
+        continue; // does not fit the entry's name field
+      Source source;
+      source.name = name;
+      source.dsetId = H5Dopen2(fileId, utf8.constData(), H5P_DEFAULT);
+      if (source.dsetId < 0)
+        continue;
+      source.fileSpace = H5Dget_space(source.dsetId);
+      if (H5Sget_simple_extent_ndims(source.fileSpace) != 3) {
+        H5Sclose(source.fileSpace);
+        H5Dclose(source.dsetId);
+        continue;
+      }
+      H5Sget_simple_extent_dims(source.fileSpace, source.dims, nullptr);
+      std::memcpy(source.entry.name, utf8.constData(), size_t(utf8.size()));
+      sources.push_back(std::move(source));
+    }
+  }
+
+  auto closeAll = [&] {
+    QMutexLocker h5(&hdf5Mutex());
+    for (Source &source : sources) {
+      H5Sclose(source.fileSpace);
+      H5Dclose(source.dsetId);
+    }
+    H5Fclose(fileId);
+  };
+
+  // layout: header, entries, per-frame ranges, then page-aligned frames
+  header.datasetCount = quint32(sources.size());
+  quint64 offset = sizeof(FramePack::FileHeader) +
+                   sources.size() * sizeof(FramePack::DatasetEntry);
+  for (Source &source : sources) {
+    source.entry.rangesOffset = offset;
+    offset += source.dims[0] * 2 * sizeof(float);
+  }
+  for (Source &source : sources) {
+    source.entry.dataOffset = alignUp(offset);
+    offset = source.entry.dataOffset +
+             source.dims[0] * source.dims[1] * source.dims[2] * 2;
+  }
+
+  QSaveFile file(FramePack::packPath(path));
+  if (sources.empty() || !file.open(QIODevice::WriteOnly)) {
+    closeAll();
+    return;
+  }
+
+  std::vector<float> slice;
+  std::vector<quint16> packed;
+  PercentileEngine histogram;
+  bool ok = true;
+  for (Source &source : sources) {
+    const size_t pixels = size_t(source.dims[1]) * source.dims[2];
+    slice.resize(pixels);
+    packed.resize(pixels);
+    source.ranges.assign(source.dims[0] * 2, 0.0f);
+    file.seek(qint64(source.entry.dataOffset));
+
+    bool quantized = true;
+    for (hsize_t frame = 0; ok && quantized && frame < source.dims[0];
+         ++frame) {
+      {
+        QMutexLocker h5(&hdf5Mutex());
+        hsize_t start[3] = {frame, 0, 0};
+        hsize_t count[3] = {1, source.dims[1], source.dims[2]};
+        hid_t memSpace = H5Screate_simple(3, count, nullptr);
+        H5Sselect_hyperslab(source.fileSpace, H5S_SELECT_SET, start, nullptr,
+                            count, nullptr);
+        ok = H5Dread(source.dsetId, H5T_NATIVE_FLOAT, memSpace,
+                     source.fileSpace, H5P_DEFAULT, slice.data()) >= 0;
+        H5Sclose(memSpace);
+      }
+      if (!ok)
+        break;
+
+      // slice 0 also gives the normalization bounds
+      if (frame == 0) {
+        const QPair<float, float> pair = wanted.value(source.name);
+        histogram.build(slice.data(), slice.size());
+        std::vector<float> values =
+            histogram.percentiles({pair.first, pair.second});
+        if (values[0] == values[1]) {
+          values[0] = histogram.minValue();
+          values[1] = histogram.maxValue();
+        }
+        source.entry.percentileLow = pair.first;
+        source.entry.percentileHigh = pair.second;
+        source.entry.lowerValue = values[0];
+        source.entry.upperValue = values[1];
+      }
+
+      quantized = quantize(slice.data(), pixels, packed.data(),
+                           source.ranges[2 * frame],
+                           source.ranges[2 * frame + 1]);
+      if (quantized)
+        ok = file.write(reinterpret_cast<const char *>(packed.data()),
+                        qint64(pixels * sizeof(quint16))) ==
+             qint64(pixels * sizeof(quint16));
+    }
+    if (!ok)
+      break;
+
+    if (quantized) {
+      source.entry.frames = quint32(source.dims[0]);
+      source.entry.xres = quint32(source.dims[1]);
+      source.entry.yres = quint32(source.dims[2]);
+    } else {
+      qDebug() << "FramePackWriter:" << source.name << "of" << path
+               << "has negative values, leaving it to HDF5.";
+    }
+  }
+  closeAll();
+
+  // ranges and the header go in last, once everything is known
+  for (const Source &source : sources) {
+    if (!ok)
+      break;
+    file.seek(qint64(source.entry.rangesOffset));
+    ok = file.write(reinterpret_cast<const char *>(source.ranges.data()),
+                    qint64(source.ranges.size() * sizeof(float))) ==
+         qint64(source.ranges.size() * sizeof(float));
+  }
+  if (ok) {
+    file.seek(0);
+    ok = file.write(reinterpret_cast<const char *>(&header),
+                    sizeof(header)) == qint64(sizeof(header));
+    for (const Source &source : sources) {
+      ok = ok && file.write(reinterpret_cast<const char *>(&source.entry),
+                            sizeof(source.entry)) ==
+                     qint64(sizeof(source.entry));
+    }
+  }
+
+  // a file that changed under us (still being written?) gets no pack
+  QFileInfo after(path);
+  if (!ok || after.lastModified() != before.lastModified() ||
+      after.size() != before.size()) {
+    file.cancelWriting();
+    qWarning() << "FramePackWriter: could not pack" << path;
+    return;
+  }
+  if (!file.commit()) {
+    qWarning() << "FramePackWriter: cannot write" << file.fileName();
+    return;
+  }
+
+  // hand the bounds on unless the background precompute beat us to it
+  for (const Source &source : sources) {
+    if (source.entry.frames == 0)
+      continue;
+    float lower, upper;
+    if (!m_normCache->lookup(fileNumber, path, source.name,
+                             source.entry.percentileLow,
+                             source.entry.percentileHigh, lower, upper))
+      m_normCache->insert(fileNumber, path, source.name,
+                          source.entry.percentileLow,
+                          source.entry.percentileHigh,
+                          source.entry.lowerValue, source.entry.upperValue);
+  }
+
+  qDebug() << "FramePackWriter: packed" << path << "("
+           << offset / (1024 * 1024) << "MiB) in" << clock.elapsed() << "ms";
+}
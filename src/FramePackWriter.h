@@ -0,0 +1,38 @@
+// FramePackWriter.h
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+class NormalizationCache;
+
+/**
+ * @brief Transcodes image files into frame packs in the background.
+ *
+ * Lives on a low-priority thread of its own.  transcode() reads every
+ * dataset of image_N.hdf5 one slice at a time, holding hdf5Mutex() only
+ * for the read itself, log-quantizes it to uint16 and writes image_N.fpk
+ * next to it (see FramePack for the format).  The pack is written to a
+ * temporary file and renamed into place, so readers never see a partial
+ * one.
+ *
+ * The slice-0 bounds for each dataset's current percentile pair are stored
+ * in the pack and handed to the NormalizationCache on the way.
+ */
+class FramePackWriter : public QObject {
+  Q_OBJECT
+public:
+  explicit FramePackWriter(NormalizationCache *normCache,
+                           QObject *parent = nullptr);
+
+public slots:
+  /// Directory the image files (and their packs) live in.
+  void setDirectory(const QString &imageDirectory);
+
+  /// Write the pack for image_<fileNumber>.hdf5 unless a current one exists.
+  void transcode(int fileNumber);
+
+private:
+  NormalizationCache *m_normCache;
+  QString m_imageDirectory;
+};
@@ -0,0 +1,143 @@
+// FramePool.cpp
+#include "FramePool.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <new>
+
+// Rows start cache-line aligned for the SIMD colormap kernels
+static constexpr std::align_val_t kBufferAlignment{64};
+
+struct FramePool::Buffer {
+  std::weak_ptr<FramePool> pool;
+  int width = 0;
+  int height = 0;
+  uchar *data = nullptr;
+
+  Buffer(int w, int h)
+      : width(w), height(h),
+        data(static_cast<uchar *>(::operator new(
+            size_t(w) * h * 4, kBufferAlignment))) {}
+  ~Buffer() { ::operator delete(data, kBufferAlignment); }
+
+  Buffer(const Buffer &) = delete;
+  Buffer &operator=(const Buffer &) = delete;
+};
+
+FramePool::FramePool(qint64 budgetBytes, int reserve)
+    : m_budget(std::max<qint64>(budgetBytes, 0)),
+      m_reserve(std::max(reserve, 0)) {}
+
+std::shared_ptr<FramePool> FramePool::create(qint64 budgetBytes,
+                                             int reserve) {
+  return std::shared_ptr<FramePool>(new FramePool(budgetBytes, reserve));
+}
+
+FramePool::~FramePool() {
+  for (Buffer *buffer : m_free)
+    delete buffer;
+}
+
+void FramePool::setBudget(qint64 budgetBytes, int reserve) {
+  QMutexLocker lock(&m_mutex);
+  m_budget = std::max<qint64>(budgetBytes, 0);
+  m_reserve = std::max(reserve, 0);
+  trim();
+}
+
+void FramePool::setReclaimer(std::function<bool()> reclaim) {
+  QMutexLocker lock(&m_mutex);
+  m_reclaim = std::move(reclaim);
+}
+
+int FramePool::buffers() const {
+  QMutexLocker lock(&m_mutex);
+  return m_buffers;
+}
+
+/**
+ * @brief Buffers of the current size the pool may hold.
+ * Caller must hold m_mutex.
+ */
+int FramePool::maxBuffers() const {
+  const qint64 frameBytes = qint64(m_width) * m_height * 4;
+  const qint64 budgeted = frameBytes > 0 ? m_budget / frameBytes : 0;
+  return int(std::min<qint64>(budgeted + m_reserve, 1 << 20));
+}
+
+/**
+ * @brief Frees idle buffers while the pool is over its cap.
+ * Caller must hold m_mutex.
+ */
+void FramePool::trim() {
+  while (m_buffers > maxBuffers() && !m_free.empty()) {
+    delete m_free.back();
+    m_free.pop_back();
+    --m_buffers;
+  }
+}
+
+QImage FramePool::acquire(int width, int height) {
+  Buffer *buffer = nullptr;
+  bool allocate = false;
+  bool cacheEmpty = false;
+  while (!buffer && !allocate) {
+    std::function<bool()> reclaim;
+    {
+      QMutexLocker lock(&m_mutex);
+      if (width != m_width || height != m_height) {
+        // new output dims: idle buffers of the old size are no use any more
+        for (Buffer *stale : m_free)
+          delete stale;
+        m_free.clear();
+        m_buffers = 0;
+        m_width = width;
+        m_height = height;
+      }
+      if (!m_free.empty()) {
+        buffer = m_free.back();
+        m_free.pop_back();
+      } else if (m_buffers < maxBuffers() || !m_reclaim || cacheEmpty) {
+        allocate = true;
+        ++m_buffers;
+      } else {
+        reclaim = m_reclaim;
+      }
+    }
+
+    // At the cap: an evicted frame nobody else holds comes straight back.
+    // If the cache is empty the working set outgrew the reserve; allocate
+    if (reclaim)
+      cacheEmpty = !reclaim();
+  }
+
+  if (buffer) {
+    m_reused.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    buffer = new Buffer(width, height);
+    buffer->pool = weak_from_this();
+    m_allocated.fetch_add(1, std::memory_order_relaxed);
+  }
+  return QImage(buffer->data, width, height, width * 4, kFormat,
+                &FramePool::recycle, buffer);
+}
+
+/**
+ * @brief QImage cleanup function: the last copy of a frame went away.
+ */
+void FramePool::recycle(void *info) {
+  Buffer *buffer = static_cast<Buffer *>(info);
+  if (std::shared_ptr<FramePool> pool = buffer->pool.lock())
+    pool->release(buffer);
+  else
+    delete buffer;
+}
+
+void FramePool::release(Buffer *buffer) {
+  QMutexLocker lock(&m_mutex);
+  if (buffer->width != m_width || buffer->height != m_height) {
+    delete buffer; // from before a size change; not counted any more
+    return;
+  }
+  m_free.push_back(buffer);
+  trim();
+}
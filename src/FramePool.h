@@ -0,0 +1,96 @@
+// FramePool.h
+#pragma once
+
+#include <QImage>
+#include <QMutex>
+#include <QtGlobal>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Recycled pixel buffers for rendered frames.
+ *
+ * acquire() hands out a QImage wrapping a preallocated buffer in the
+ * raster engine's native format.  The image carries a cleanup function, so
+ * when the last copy goes away (the label painted the next frame, the
+ * frame cache evicted it, ...) the buffer drops back into the pool instead
+ * of being freed.  Frames cross threads by reference count only: in steady
+ * state rendering allocates nothing and copies nothing.
+ *
+ * Only buffers of the current size are kept; a size change lets the old
+ * ones drain.
+ *
+ * The pool is capped: budget bytes worth of frames plus a few reserve
+ * frames, counting both idle buffers and those still out.  Frames held by
+ * the FrameCache are pool buffers too, so the cache shares that budget:
+ * when an acquire() finds no idle buffer at the cap, the reclaimer evicts
+ * the cache's oldest frame and its buffer is reused.  Once the pool has
+ * grown to the cap it allocates nothing more, whatever the cache does
+ * (evictions, clear() after a normalization change).
+ *
+ * Thread-safe.  Buffers may outlive the pool (a frame still on screen at
+ * shutdown); they then simply free themselves.
+ */
+class FramePool : public std::enable_shared_from_this<FramePool> {
+public:
+  /// Opaque alpha from the LUT makes premultiplied a no-op to produce.
+  static constexpr QImage::Format kFormat = QImage::Format_ARGB32_Premultiplied;
+
+  static std::shared_ptr<FramePool> create(qint64 budgetBytes = 0,
+                                           int reserve = 8);
+  ~FramePool();
+
+  FramePool(const FramePool &) = delete;
+  FramePool &operator=(const FramePool &) = delete;
+
+  /// A width x height frame, recycled if possible.  Contents are undefined.
+  QImage acquire(int width, int height);
+
+  /**
+   * @brief Cap the pool at @p budgetBytes of frames plus @p reserve frames.
+   *
+   * The reserve covers frames in flight outside the cache (the ring, the
+   * one on screen).  Idle buffers past a lowered cap are freed.
+   */
+  void setBudget(qint64 budgetBytes, int reserve);
+
+  /**
+   * @brief Called, without the pool's lock, when acquire() is at the cap.
+   *
+   * Should drop the least recently used cached frame and return false if
+   * there was none, in which case the pool allocates past the cap rather
+   * than stall.  Must not call back into acquire().
+   */
+  void setReclaimer(std::function<bool()> reclaim);
+
+  /// Buffers of the current size, idle or out.
+  int buffers() const;
+
+  quint64 reused() const { return m_reused.load(std::memory_order_relaxed); }
+  quint64 allocated() const {
+    return m_allocated.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Buffer;
+
+  FramePool(qint64 budgetBytes, int reserve);
+  static void recycle(void *info);
+  void release(Buffer *buffer);
+  int maxBuffers() const;
+  void trim();
+
+  mutable QMutex m_mutex; // guards everything below
+  std::vector<Buffer *> m_free;
+  int m_width = 0;
+  int m_height = 0;
+  int m_buffers = 0; ///< current size, idle or out
+  qint64 m_budget;
+  int m_reserve;
+  std::function<bool()> m_reclaim;
+
+  std::atomic<quint64> m_reused{0};
+  std::atomic<quint64> m_allocated{0};
+};
@@ -0,0 +1,72 @@
+// FrameRing.cpp
+#include "FrameRing.h"
+#include <QMutexLocker>
+#include <algorithm>
+
+FrameRing::FrameRing(int capacity) : m_capacity(std::clamp(capacity, 2, 64)) {}
+
+void FrameRing::setCapacity(int capacity) {
+  QMutexLocker lock(&m_mutex);
+  m_capacity = std::clamp(capacity, 2, 64);
+  m_frames.clear();
+  m_notFull.wakeAll();
+}
+
+int FrameRing::capacity() const {
+  QMutexLocker lock(&m_mutex);
+  return m_capacity;
+}
+
+bool FrameRing::push(RingFrame &&frame) {
+  QMutexLocker lock(&m_mutex);
+  while (!m_stopped && frame.generation == m_generation &&
+         int(m_frames.size()) >= m_capacity)
+    m_notFull.wait(&m_mutex);
+
+  if (m_stopped || frame.generation != m_generation)
+    return false;
+
+  m_frames.push_back(std::move(frame));
+  return true;
+}
+
+bool FrameRing::tryPop(int generation, int frameIndex, RingFrame &out) {
+  QMutexLocker lock(&m_mutex);
+
+  // Anything ahead of the wanted frame is left over from before a resync
+  while (!m_frames.empty() && (m_frames.front().generation != generation ||
+                               m_frames.front().frameIndex != frameIndex)) {
+    m_frames.pop_front();
+    m_notFull.wakeAll();
+  }
+
+  if (m_frames.empty()) {
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  out = std::move(m_frames.front());
+  m_frames.pop_front();
+  m_notFull.wakeAll();
+  m_hits.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+void FrameRing::reset(int generation) {
+  QMutexLocker lock(&m_mutex);
+  m_generation = generation;
+  m_frames.clear();
+  m_notFull.wakeAll();
+}
+
+void FrameRing::stop() {
+  QMutexLocker lock(&m_mutex);
+  m_stopped = true;
+  m_frames.clear();
+  m_notFull.wakeAll();
+}
+
+bool FrameRing::isStopped() const {
+  QMutexLocker lock(&m_mutex);
+  return m_stopped;
+}
@@ -0,0 +1,70 @@
+// FrameRing.h
+#pragma once
+
+#include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+
+/**
+ * @brief A decoded, colormapped rotation frame waiting to be shown.
+ */
+struct RingFrame {
+  int generation = 0; ///< Loader generation the frame was rendered for
+  int fileNumber = -1;
+  int frameIndex = -1;
+  QImage image;
+};
+
+/**
+ * @brief Bounded, thread-safe read-ahead ring of rendered frames.
+ *
+ * A single producer (the prefetch stage) pushes frames N+1..N+k in rotation
+ * order while the consumer (the rotation clock) pops the frame it needs.
+ * Every time the loader switches file, dataset or normalization it bumps the
+ * generation with reset(), which drops anything rendered for the old state.
+ */
+class FrameRing {
+public:
+  explicit FrameRing(int capacity = 16);
+
+  /// Change the read-ahead depth (clamped to [2, 64]); clears the ring.
+  void setCapacity(int capacity);
+  int capacity() const;
+
+  /**
+   * @brief Push a rendered frame, blocking while the ring is full.
+   * @return false if the frame is stale (old generation) or the ring stopped.
+   */
+  bool push(RingFrame &&frame);
+
+  /**
+   * @brief Pop the frame for @p frameIndex of @p generation if it is ready.
+   *
+   * Frames at the front that do not match are discarded.  Never blocks.
+   * Counts a hit when the frame was ready and a miss otherwise.
+   */
+  bool tryPop(int generation, int frameIndex, RingFrame &out);
+
+  /// Drop everything and start accepting frames for @p generation.
+  void reset(int generation);
+
+  /// Wake and release the producer for good (used on shutdown).
+  void stop();
+  bool isStopped() const;
+
+  quint64 hits() const { return m_hits.load(std::memory_order_relaxed); }
+  quint64 misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+private:
+  mutable QMutex m_mutex;
+  QWaitCondition m_notFull;
+  std::deque<RingFrame> m_frames;
+  int m_capacity;
+  int m_generation = 0;
+  bool m_stopped = false;
+
+  std::atomic<quint64> m_hits{0};
+  std::atomic<quint64> m_misses{0};
+};
@@ -0,0 +1,107 @@
+// FrameScheduler.cpp
+#include "FrameScheduler.h"
+#include <QDebug>
+#include <QStringList>
+#include <algorithm>
+
+// Ticks per adaptation decision (~2 s at 25 fps)
+static constexpr int kAdaptWindow = 50;
+
+// Late fractions that lower / raise the effective rate
+static constexpr double kSlowDownLate = 0.10;
+static constexpr double kSpeedUpLate = 0.02;
+
+void FrameScheduler::start(int fps) {
+  m_nominalFps = std::max(fps, 1);
+  setEffectiveFps(m_nominalFps);
+  m_clock.start();
+  m_nextNs = m_periodNs;
+  m_windowTicks = m_windowLate = 0;
+}
+
+void FrameScheduler::resume() {
+  // the time spent paused is not lateness
+  m_clock.start();
+  m_nextNs = m_periodNs;
+  m_windowTicks = m_windowLate = 0;
+}
+
+void FrameScheduler::setEffectiveFps(int fps) {
+  m_effectiveFps = fps;
+  m_periodNs = 1000000000LL / fps;
+}
+
+int FrameScheduler::msUntilNext() const {
+  qint64 ns = m_nextNs - m_clock.nsecsElapsed();
+  return ns <= 0 ? 0 : int((ns + 999999) / 1000000);
+}
+
+int FrameScheduler::tick() {
+  const qint64 now = m_clock.nsecsElapsed();
+  const qint64 lateNs = std::max<qint64>(now - m_nextNs, 0);
+
+  // every deadline that has fully passed is a frame nobody will see
+  const int advance = 1 + int(lateNs / m_periodNs);
+  m_nextNs += qint64(advance) * m_periodNs;
+
+  ++m_ticks;
+  m_dropped += quint64(advance - 1);
+  const bool late = lateNs >= m_periodNs / 2;
+  if (late)
+    ++m_late;
+
+  const qint64 lateMs = lateNs / 1000000;
+  size_t bin = 0;
+  while (bin < kJitterEdgesMs.size() && lateMs >= kJitterEdgesMs[bin])
+    ++bin;
+  ++m_jitter[bin];
+
+  ++m_windowTicks;
+  m_windowLate += late ? 1 : 0;
+  if (m_windowTicks >= kAdaptWindow)
+    adapt();
+  return advance;
+}
+
+/**
+ * @brief Steps the effective rate at the end of an adaptation window.
+ *
+ * Down by a fifth when too many ticks were late, up by one fps at a time
+ * when nearly none were, within [nominal / 4, nominal].
+ */
+void FrameScheduler::adapt() {
+  const double lateFraction = double(m_windowLate) / m_windowTicks;
+  m_windowTicks = m_windowLate = 0;
+
+  int fps = m_effectiveFps;
+  if (lateFraction > kSlowDownLate)
+    fps = std::max(std::max(m_nominalFps / 4, 1), fps * 4 / 5);
+  else if (lateFraction < kSpeedUpLate)
+    fps = std::min(m_nominalFps, fps + 1);
+  if (fps == m_effectiveFps)
+    return;
+
+  qDebug() << "FrameScheduler:" << lateFraction * 100 << "% of frames late,"
+           << "pacing at" << fps << "of" << m_nominalFps << "fps";
+
+  // keep the pending deadline, just respace the ones after it
+  setEffectiveFps(fps);
+}
+
+QString FrameScheduler::takeJitterHistogram() {
+  QStringList bins;
+  for (size_t i = 0; i < m_jitter.size(); ++i) {
+    QString label;
+    if (i == 0)
+      label = QString("<%1ms").arg(kJitterEdgesMs[0]);
+    else if (i == kJitterEdgesMs.size())
+      label = QString(">%1ms").arg(kJitterEdgesMs[i - 1]);
+    else
+      label = QString("%1-%2ms")
+                  .arg(kJitterEdgesMs[i - 1])
+                  .arg(kJitterEdgesMs[i]);
+    bins << QString("%1:%2").arg(label).arg(m_jitter[i]);
+  }
+  m_jitter.fill(0);
+  return bins.join(' ');
+}
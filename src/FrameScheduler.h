@@ -0,0 +1,75 @@
+// FrameScheduler.h
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QtGlobal>
+#include <array>
+
+/**
+ * @brief Deadline-based pacing for the rotation clock.
+ *
+ * Every frame has a deadline on a monotonic clock, one period after the
+ * previous one.  When a tick comes in late by a period or more, the frames
+ * it missed are skipped rather than shown back to back, so a slow read or
+ * render never leaves a backlog behind.
+ *
+ * If ticks keep coming in late the effective frame rate is stepped down
+ * (to no less than a quarter of the nominal rate), and stepped back up once
+ * the loader keeps up again.  Lateness is binned into a small histogram for
+ * the periodic stats.
+ *
+ * Not thread-safe; owned by the loader thread.
+ */
+class FrameScheduler {
+public:
+  /// Lateness bin upper edges in ms; the last bin is open ended.
+  static constexpr std::array<int, 7> kJitterEdgesMs = {1,  2,  5,  10,
+                                                        20, 50, 100};
+
+  /// (Re)start the clock at @p fps; the first deadline is one period out.
+  void start(int fps);
+
+  /// Restart the deadlines after a pause, keeping the rate and the stats.
+  void resume();
+
+  int nominalFps() const { return m_nominalFps; }
+  int effectiveFps() const { return m_effectiveFps; }
+
+  /// Milliseconds until the next deadline (rounded up, at least 0).
+  int msUntilNext() const;
+
+  /**
+   * @brief Account for a tick and move to the next deadline.
+   *
+   * @return how many frames the rotation should advance: 1 when on time,
+   * more when frames had to be dropped.
+   */
+  int tick();
+
+  quint64 ticks() const { return m_ticks; }
+  quint64 lateFrames() const { return m_late; }
+  quint64 droppedFrames() const { return m_dropped; }
+
+  /// "<1ms:n 1-2ms:n ... >100ms:n" for the log; then clears the histogram.
+  QString takeJitterHistogram();
+
+private:
+  void setEffectiveFps(int fps);
+  void adapt();
+
+  QElapsedTimer m_clock;
+  int m_nominalFps = 25;
+  int m_effectiveFps = 25;
+  qint64 m_periodNs = 40000000;
+  qint64 m_nextNs = 0; ///< deadline of the next frame, on m_clock
+
+  quint64 m_ticks = 0;
+  quint64 m_late = 0;    ///< shown half a period or more after the deadline
+  quint64 m_dropped = 0; ///< skipped because their deadline had passed
+  std::array<quint64, kJitterEdgesMs.size() + 1> m_jitter{};
+
+  // adaptation window
+  int m_windowTicks = 0;
+  int m_windowLate = 0;
+};
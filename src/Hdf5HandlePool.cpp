@@ -0,0 +1,513 @@
+// Hdf5HandlePool.cpp
+#include "Hdf5HandlePool.h"
+#include "Hdf5Lock.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Upper bound for one dataset's chunk cache; the pool keeps several open
+constexpr size_t kMaxChunkCacheBytes = size_t(128) * 1024 * 1024;
+
+size_t nextPrime(size_t n) {
+  auto isPrime = [](size_t v) {
+    if (v < 2)
+      return false;
+    for (size_t d = 2; d * d <= v; ++d)
+      if (v % d == 0)
+        return false;
+    return true;
+  };
+  while (!isPrime(n))
+    ++n;
+  return n;
+}
+
+/// H5Pset_chunk_cache() arguments.
+struct ChunkCachePlan {
+  size_t bytes = 0;
+  size_t nslots = 0;
+  double w0 = 1.0;
+};
+
+/**
+ * @brief Chunk cache for reading dims[0] slices one after the other.
+ *
+ * If a chunk spans several frames the cache must hold a whole frame group
+ * (every chunk the slice touches) or each chunk is re-read, and
+ * decompressed, once per frame.  With one frame per chunk nothing is
+ * reused across frames, so a single chunk is enough and fully read chunks
+ * can go first.  benchmarkRotationLayouts() times this against the
+ * alternatives.  @p wanted receives the size before the 128 MiB cap.
+ */
+ChunkCachePlan rotationChunkCache(const hsize_t chunk[3],
+                                  const hsize_t dims[3], size_t elementBytes,
+                                  size_t *wanted = nullptr) {
+  const size_t chunkBytes = std::max<size_t>(
+      size_t(chunk[0]) * chunk[1] * chunk[2] * elementBytes, 1);
+  const size_t chunksPerFrame = size_t((dims[1] + chunk[1] - 1) / chunk[1]) *
+                                ((dims[2] + chunk[2] - 1) / chunk[2]);
+
+  ChunkCachePlan plan;
+  plan.bytes = chunkBytes;
+  if (chunk[0] > 1) {
+    // whole frame group; slices never read a chunk fully, so w0 is moot
+    plan.bytes = chunksPerFrame * chunkBytes;
+    plan.w0 = 0.0;
+  }
+  if (wanted)
+    *wanted = plan.bytes;
+  if (plan.bytes > kMaxChunkCacheBytes)
+    plan.bytes = std::max(chunkBytes, kMaxChunkCacheBytes);
+
+  // ~100 hash slots per cached chunk keeps collisions rare
+  size_t cachedChunks = std::max<size_t>(plan.bytes / chunkBytes, 1);
+  plan.nslots =
+      nextPrime(std::clamp<size_t>(cachedChunks * 100, 521, 1 << 20));
+  return plan;
+}
+
+/**
+ * @brief Dataset access plist with a chunk cache tuned for rotation.
+ *
+ * See rotationChunkCache().  The choice is logged whenever it changes for
+ * a dataset name.  Caller holds hdf5Mutex(), which also guards the log
+ * state.
+ *
+ * @return H5P_DEFAULT for contiguous/compact layouts (no chunk cache).
+ */
+hid_t rotationAccessPlist(hid_t dsetId, const hsize_t dims[3],
+                          const QString &datasetKey) {
+  static QHash<QString, QString> lastPlan;
+  auto report = [&](const QString &plan) {
+    if (lastPlan.value(datasetKey) == plan)
+      return;
+    lastPlan.insert(datasetKey, plan);
+    qDebug().noquote() << "Hdf5HandlePool:" << datasetKey << plan;
+  };
+
+  hid_t dcpl = H5Dget_create_plist(dsetId);
+  if (dcpl < 0)
+    return H5P_DEFAULT;
+
+  if (H5Pget_layout(dcpl) != H5D_CHUNKED) {
+    report("is not chunked, chunk cache unused");
+    H5Pclose(dcpl);
+    return H5P_DEFAULT;
+  }
+
+  hsize_t chunk[3] = {1, 1, 1};
+  int rank = H5Pget_chunk(dcpl, 3, chunk);
+  int filters = H5Pget_nfilters(dcpl);
+  H5Pclose(dcpl);
+  if (rank != 3)
+    return H5P_DEFAULT;
+
+  hid_t type = H5Dget_type(dsetId);
+  size_t elementBytes = type >= 0 ? H5Tget_size(type) : sizeof(float);
+  if (type >= 0)
+    H5Tclose(type);
+
+  size_t wanted = 0;
+  const ChunkCachePlan plan =
+      rotationChunkCache(chunk, dims, elementBytes, &wanted);
+  if (wanted > kMaxChunkCacheBytes)
+    qWarning() << "Hdf5HandlePool:" << datasetKey << "needs"
+               << wanted / (1 << 20)
+               << "MiB to cache one frame group; capped, expect re-reads.";
+
+  hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
+  H5Pset_chunk_cache(dapl, plan.nslots, plan.bytes, plan.w0);
+  report(QString("chunked %1x%2x%3 with %4 filter(s): chunk cache %5 KiB, "
+                 "%6 slots, w0 %7")
+             .arg(qulonglong(chunk[0]))
+             .arg(qulonglong(chunk[1]))
+             .arg(qulonglong(chunk[2]))
+             .arg(filters)
+             .arg(qulonglong(plan.bytes / 1024))
+             .arg(qulonglong(plan.nslots))
+             .arg(plan.w0));
+  return dapl;
+}
+
+/**
+ * @brief Raw file offset of a contiguous, native-float dataset.
+ *
+ * Contiguous storage cannot carry filters, so those bytes are exactly the
+ * floats in row-major order.  HADDR_UNDEF if the dataset is chunked, of
+ * another type or has no storage allocated yet.
+ */
+haddr_t mappableOffset(hid_t dsetId) {
+  hid_t dcpl = H5Dget_create_plist(dsetId);
+  if (dcpl < 0)
+    return HADDR_UNDEF;
+  bool contiguous = H5Pget_layout(dcpl) == H5D_CONTIGUOUS;
+  H5Pclose(dcpl);
+  if (!contiguous)
+    return HADDR_UNDEF;
+
+  hid_t type = H5Dget_type(dsetId);
+  bool nativeFloat = type >= 0 && H5Tequal(type, H5T_NATIVE_FLOAT) > 0;
+  if (type >= 0)
+    H5Tclose(type);
+  return nativeFloat ? H5Dget_offset(dsetId) : HADDR_UNDEF;
+}
+
+/**
+ * @brief Writes @p cube to a new file as dataset "data".
+ *
+ * Contiguous if @p chunk[0] is 0, else chunked with shuffle and, if
+ * @p deflate, deflate, as image files usually are.
+ */
+bool writeBenchCube(const QString &path, const hsize_t dims[3],
+                    const hsize_t chunk[3], bool deflate,
+                    const std::vector<float> &cube) {
+  hid_t fileId = H5Fcreate(path.toUtf8().constData(), H5F_ACC_TRUNC,
+                           H5P_DEFAULT, H5P_DEFAULT);
+  if (fileId < 0)
+    return false;
+  hid_t space = H5Screate_simple(3, dims, nullptr);
+  hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  if (chunk[0] > 0) {
+    H5Pset_chunk(dcpl, 3, chunk);
+    H5Pset_shuffle(dcpl);
+    if (deflate)
+      H5Pset_deflate(dcpl, 4);
+  }
+  hid_t dsetId = H5Dcreate2(fileId, "data", H5T_NATIVE_FLOAT, space,
+                            H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  bool ok = dsetId >= 0 && H5Dwrite(dsetId, H5T_NATIVE_FLOAT, H5S_ALL,
+                                    H5S_ALL, H5P_DEFAULT, cube.data()) >= 0;
+  if (dsetId >= 0)
+    H5Dclose(dsetId);
+  H5Pclose(dcpl);
+  H5Sclose(space);
+  H5Fclose(fileId);
+  return ok;
+}
+
+/**
+ * @brief Reads every slice of "data" in @p path in rotation order.
+ *
+ * The dataset is opened with @p dapl, so each pass starts with an empty
+ * chunk cache.  @return mean and worst ms per frame, or -1 on failure.
+ */
+std::pair<double, double> timeRotation(const QString &path,
+                                       const hsize_t dims[3], hid_t dapl,
+                                       std::vector<float> &slice) {
+  hid_t fileId =
+      H5Fopen(path.toUtf8().constData(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (fileId < 0)
+    return {-1.0, -1.0};
+  hid_t dsetId = H5Dopen2(fileId, "data", dapl);
+  hid_t fileSpace = dsetId >= 0 ? H5Dget_space(dsetId) : -1;
+  const hsize_t count[3] = {1, dims[1], dims[2]};
+  hid_t memSpace = H5Screate_simple(3, count, nullptr);
+
+  double total = 0.0, worst = 0.0;
+  bool ok = fileSpace >= 0;
+  for (hsize_t frame = 0; ok && frame < dims[0]; ++frame) {
+    QElapsedTimer clock;
+    clock.start();
+    const hsize_t start[3] = {frame, 0, 0};
+    H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, start, nullptr, count,
+                        nullptr);
+    ok = H5Dread(dsetId, H5T_NATIVE_FLOAT, memSpace, fileSpace, H5P_DEFAULT,
+                 slice.data()) >= 0;
+    const double ms = double(clock.nsecsElapsed()) / 1e6;
+    total += ms;
+    worst = std::max(worst, ms);
+  }
+
+  H5Sclose(memSpace);
+  if (fileSpace >= 0)
+    H5Sclose(fileSpace);
+  if (dsetId >= 0)
+    H5Dclose(dsetId);
+  H5Fclose(fileId);
+  if (!ok)
+    return {-1.0, -1.0};
+  return {total / double(dims[0]), worst};
+}
+
+} // namespace
+
+void benchmarkRotationLayouts() {
+  constexpr hsize_t kFrames = 64;
+  constexpr hsize_t kSide = 512;
+  constexpr int kRuns = 3;
+  const hsize_t dims[3] = {kFrames, kSide, kSide};
+
+  QTemporaryDir dir;
+  if (!dir.isValid()) {
+    qWarning() << "Hdf5HandlePool: no scratch directory for the layout "
+                  "benchmark";
+    return;
+  }
+
+  // a log-normal-ish field with empty pixels, like the density images
+  std::vector<float> cube(size_t(kFrames) * kSide * kSide);
+  uint32_t state = 12345u;
+  for (float &v : cube) {
+    state = state * 1664525u + 1013904223u;
+    float u = float(state >> 8) / float(1 << 24);
+    v = u < 0.1f ? 0.0f : std::exp2(24.0f * u - 8.0f);
+  }
+  std::vector<float> slice(size_t(kSide) * kSide);
+
+  struct Layout {
+    const char *name;
+    hsize_t chunk[3]; ///< all 0 = contiguous
+  };
+  const Layout layouts[] = {
+      {"per-frame", {1, kSide, kSide}},
+      {"frame-group", {8, kSide / 4, kSide / 4}},
+      {"contiguous", {0, 0, 0}},
+  };
+
+  QMutexLocker h5(&hdf5Mutex());
+  const bool deflate = H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0;
+  for (const Layout &layout : layouts) {
+    const QString path = dir.filePath(QString("%1.hdf5").arg(layout.name));
+    if (!writeBenchCube(path, dims, layout.chunk, deflate, cube)) {
+      qWarning() << "Hdf5HandlePool: cannot write" << path;
+      continue;
+    }
+
+    // the plan rotationAccessPlist() would pick, and what it replaces
+    struct Setting {
+      QString name;
+      hid_t dapl;
+    };
+    std::vector<Setting> settings;
+    if (layout.chunk[0] == 0) {
+      settings.push_back({"no chunk cache", H5P_DEFAULT});
+    } else {
+      auto add = [&](const QString &name, const ChunkCachePlan &plan) {
+        hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
+        H5Pset_chunk_cache(dapl, plan.nslots, plan.bytes, plan.w0);
+        settings.push_back({name, dapl});
+      };
+      const ChunkCachePlan planned =
+          rotationChunkCache(layout.chunk, dims, sizeof(float));
+      const size_t chunkBytes = size_t(layout.chunk[0]) * layout.chunk[1] *
+                                layout.chunk[2] * sizeof(float);
+      add(QString("planned %1 KiB, w0 %2")
+              .arg(qulonglong(planned.bytes / 1024))
+              .arg(planned.w0),
+          planned);
+      if (planned.bytes != chunkBytes)
+        add(QString("one chunk %1 KiB, w0 1")
+                .arg(qulonglong(chunkBytes / 1024)),
+            {chunkBytes, 521, 1.0});
+      settings.push_back({"library default 1024 KiB, w0 0.75", H5P_DEFAULT});
+      add("none", {0, 521, 1.0});
+    }
+
+    for (const Setting &setting : settings) {
+      double mean = -1.0, worst = -1.0;
+      for (int run = 0; run < kRuns; ++run) {
+        const auto [runMean, runWorst] =
+            timeRotation(path, dims, setting.dapl, slice);
+        if (runMean >= 0.0 && (mean < 0.0 || runMean < mean)) {
+          mean = runMean;
+          worst = runWorst;
+        }
+      }
+      if (setting.dapl != H5P_DEFAULT)
+        H5Pclose(setting.dapl);
+      if (mean < 0.0) {
+        qWarning() << "Hdf5HandlePool: cannot read" << path;
+        continue;
+      }
+      qDebug().noquote() << "Hdf5HandlePool:" << layout.name
+                         << setting.name << "-" << mean
+                         << "ms/frame, worst" << worst << "ms";
+    }
+  }
+}
+
+Hdf5HandlePool::Hdf5HandlePool(int capacity)
+    : m_capacity(std::clamp(capacity, 2, 64)) {}
+
+Hdf5HandlePool::~Hdf5HandlePool() { clear(); }
+
+void Hdf5HandlePool::setCapacity(int capacity) {
+  m_capacity = std::clamp(capacity, 2, 64);
+  evictTo(m_capacity);
+}
+
+Hdf5FileHandles *Hdf5HandlePool::acquire(const QString &path) {
+  QFileInfo info(path);
+  qint64 mtimeMs = info.lastModified().toMSecsSinceEpoch();
+  qint64 size = info.size();
+
+  auto it = m_index.find(path);
+  if (it != m_index.end()) {
+    auto entry = it.value();
+    if (entry->mtimeMs == mtimeMs && entry->size == size) {
+      ++m_hits;
+      m_files.splice(m_files.begin(), m_files, entry);
+      return &m_files.front();
+    }
+    // rewritten underneath us; drop the stale handles
+    close(*entry);
+    m_files.erase(entry);
+    m_index.erase(it);
+  }
+  ++m_misses;
+
+  // Chunk caches are sized per dataset (see dataset()); the file access
+  // plist only carries the optional page buffer
+  hid_t fileId = -1;
+  if (m_pageBufferBytes > 0) {
+    hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_page_buffer_size(fapl, size_t(m_pageBufferBytes), 0, 0);
+    // only files written with paged aggregation accept a page buffer
+    H5E_BEGIN_TRY {
+      fileId = H5Fopen(path.toUtf8().constData(), H5F_ACC_RDONLY, fapl);
+    }
+    H5E_END_TRY;
+    H5Pclose(fapl);
+    if (fileId < 0 && !m_warnedPageBuffer) {
+      qDebug() << "Hdf5HandlePool:" << path
+               << "is not paged, opening without a page buffer.";
+      m_warnedPageBuffer = true;
+    }
+  }
+  if (fileId < 0)
+    fileId = H5Fopen(path.toUtf8().constData(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (fileId < 0)
+    return nullptr;
+
+  Hdf5FileHandles file;
+  file.path = path;
+  file.fileId = fileId;
+  file.mtimeMs = mtimeMs;
+  file.size = size;
+
+  // Read the age attribute from the root group
+  hid_t rootGroup = H5Gopen2(fileId, "/", H5P_DEFAULT);
+  if (rootGroup >= 0) {
+    hid_t ageAttr = H5Aopen_name(rootGroup, "age");
+    if (ageAttr >= 0) {
+      file.hasAge = H5Aread(ageAttr, H5T_NATIVE_DOUBLE, &file.age) >= 0;
+      H5Aclose(ageAttr);
+    }
+    H5Gclose(rootGroup);
+  } else {
+    qWarning() << "Hdf5HandlePool: failed to open root group of" << path;
+  }
+
+  m_files.push_front(std::move(file));
+  m_index.insert(path, m_files.begin());
+  evictTo(m_capacity);
+  return &m_files.front();
+}
+
+const Hdf5DatasetHandles &Hdf5HandlePool::dataset(Hdf5FileHandles &file,
+                                                  const QString &datasetKey) {
+  auto it = file.datasets.find(datasetKey);
+  if (it != file.datasets.end())
+    return it.value();
+
+  const QByteArray name = datasetKey.toUtf8();
+  Hdf5DatasetHandles handles;
+  handles.dsetId = H5Dopen2(file.fileId, name.constData(), H5P_DEFAULT);
+  if (handles.dsetId >= 0) {
+    handles.fileSpace = H5Dget_space(handles.dsetId);
+    if (H5Sget_simple_extent_ndims(handles.fileSpace) == 3)
+      H5Sget_simple_extent_dims(handles.fileSpace, handles.dims, nullptr);
+
+    // the chunk cache is fixed at open time, so reopen with a tuned one
+    hid_t dapl = rotationAccessPlist(handles.dsetId, handles.dims, datasetKey);
+    if (dapl != H5P_DEFAULT) {
+      hid_t tuned = H5Dopen2(file.fileId, name.constData(), dapl);
+      H5Pclose(dapl);
+      if (tuned >= 0) {
+        H5Dclose(handles.dsetId);
+        handles.dsetId = tuned;
+      }
+    } else {
+      // not chunked: maybe we can skip HDF5 for the data altogether
+      handles.rawOffset = mappableOffset(handles.dsetId);
+    }
+  }
+  // failures are remembered too, so a missing dataset isn't retried
+  return file.datasets.insert(datasetKey, handles).value();
+}
+
+void Hdf5HandlePool::setPageBufferSize(qint64 bytes) {
+  m_pageBufferBytes = std::max<qint64>(bytes, 0);
+  m_warnedPageBuffer = false;
+  clear(); // the page buffer is chosen at open time
+}
+
+bool Hdf5HandlePool::contains(const QString &path) const {
+  auto it = m_index.constFind(path);
+  if (it == m_index.constEnd())
+    return false;
+  QFileInfo info(path);
+  return it.value()->mtimeMs == info.lastModified().toMSecsSinceEpoch() &&
+         it.value()->size == info.size();
+}
+
+bool Hdf5HandlePool::take(const QString &path, Hdf5FileHandles &file) {
+  auto it = m_index.find(path);
+  if (it == m_index.end())
+    return false;
+  file = std::move(*it.value());
+  m_files.erase(it.value());
+  m_index.erase(it);
+  return true;
+}
+
+void Hdf5HandlePool::adopt(Hdf5FileHandles file) {
+  auto it = m_index.find(file.path);
+  if (it != m_index.end()) {
+    close(*it.value());
+    m_files.erase(it.value());
+    m_index.erase(it);
+  }
+  const QString path = file.path;
+  m_files.push_front(std::move(file));
+  m_index.insert(path, m_files.begin());
+  evictTo(m_capacity);
+}
+
+void Hdf5HandlePool::clear() {
+  for (Hdf5FileHandles &file : m_files)
+    close(file);
+  m_files.clear();
+  m_index.clear();
+}
+
+void Hdf5HandlePool::close(Hdf5FileHandles &file) {
+  // tear down HDF5 in reverse order
+  for (const Hdf5DatasetHandles &handles : file.datasets) {
+    if (handles.fileSpace >= 0)
+      H5Sclose(handles.fileSpace);
+    if (handles.dsetId >= 0)
+      H5Dclose(handles.dsetId);
+  }
+  file.datasets.clear();
+  if (file.fileId >= 0)
+    H5Fclose(file.fileId);
+  file.fileId = -1;
+}
+
+void Hdf5HandlePool::evictTo(int count) {
+  while (int(m_files.size()) > count) {
+    Hdf5FileHandles &oldest = m_files.back();
+    m_index.remove(oldest.path);
+    close(oldest);
+    m_files.pop_back();
+  }
+}
@@ -0,0 +1,128 @@
+// Hdf5HandlePool.h
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QtGlobal>
+#include <hdf5.h>
+#include <list>
+
+/**
+ * @brief An open dataset and its file dataspace, plus the extent.
+ */
+struct Hdf5DatasetHandles {
+  hid_t dsetId = -1;
+  hid_t fileSpace = -1;
+  hsize_t dims[3] = {0, 0, 0};
+  /// File offset of the raw floats if the dataset is contiguous, unfiltered
+  /// native float (i.e. can be memory mapped), else HADDR_UNDEF.
+  haddr_t rawOffset = HADDR_UNDEF;
+};
+
+/**
+ * @brief Everything we keep open for one image file.
+ *
+ * The root group's age attribute is read once on open, so revisiting a
+ * file needs no metadata reads at all.  Datasets are opened lazily.
+ */
+struct Hdf5FileHandles {
+  QString path;
+  hid_t fileId = -1;
+  double age = 0.0;
+  bool hasAge = false;
+  qint64 mtimeMs = 0; ///< mtime / size at open; a change forces a reopen
+  qint64 size = 0;
+  QHash<QString, Hdf5DatasetHandles> datasets;
+};
+
+/**
+ * @brief Least-recently-used pool of open HDF5 files and datasets.
+ *
+ * Scrubbing the knob revisits the same handful of files over and over;
+ * keeping them open turns a revisit into a hash lookup instead of an
+ * H5Fopen plus metadata reads.  Handles returned by acquire()/dataset()
+ * stay valid until the bundle is evicted, i.e. until @c capacity other
+ * files have been acquired since, or the pool is cleared/resized.
+ *
+ * Each chunked dataset is opened with a chunk cache sized from its chunk
+ * layout for the rotation access pattern (see Hdf5HandlePool.cpp), and
+ * files can optionally be opened with an HDF5 page buffer.
+ *
+ * Not thread-safe on its own: every call must be made with hdf5Mutex()
+ * held (and by whoever owns the handles it hands out).
+ */
+class Hdf5HandlePool {
+public:
+  explicit Hdf5HandlePool(int capacity = 6);
+  ~Hdf5HandlePool();
+
+  Hdf5HandlePool(const Hdf5HandlePool &) = delete;
+  Hdf5HandlePool &operator=(const Hdf5HandlePool &) = delete;
+
+  /// Max open files (clamped to [2, 64]); evicts the excess.
+  void setCapacity(int capacity);
+  int capacity() const { return m_capacity; }
+
+  /**
+   * @brief HDF5 page buffer per file in bytes (0 = off, the default).
+   *
+   * Only takes effect for files written with paged aggregation; others
+   * fall back to a plain open.  Closes all pooled files.
+   */
+  void setPageBufferSize(qint64 bytes);
+
+  /**
+   * @brief Open (or reuse) the file at @p path and mark it most recent.
+   * @return nullptr if the file cannot be opened.
+   */
+  Hdf5FileHandles *acquire(const QString &path);
+
+  /// Open (or reuse) @p datasetKey in @p file; dsetId < 0 on failure.
+  const Hdf5DatasetHandles &dataset(Hdf5FileHandles &file,
+                                    const QString &datasetKey);
+
+  /// Whether @p path is open and has not been rewritten since.
+  bool contains(const QString &path) const;
+
+  /**
+   * @brief Move the bundle for @p path out of the pool, still open.
+   *
+   * Lets a file opened by a background pool be handed to another one with
+   * adopt() without reopening anything.
+   * @return false if the pool does not hold @p path.
+   */
+  bool take(const QString &path, Hdf5FileHandles &file);
+
+  /// Add an open bundle as the most recent, replacing any for its path.
+  void adopt(Hdf5FileHandles file);
+
+  /// Close everything.
+  void clear();
+
+  quint64 hits() const { return m_hits; }
+  quint64 misses() const { return m_misses; }
+
+private:
+  static void close(Hdf5FileHandles &file);
+  void evictTo(int count);
+
+  std::list<Hdf5FileHandles> m_files; // front = most recently used
+  QHash<QString, std::list<Hdf5FileHandles>::iterator> m_index;
+  int m_capacity;
+  qint64 m_pageBufferBytes = 0;
+  bool m_warnedPageBuffer = false;
+  quint64 m_hits = 0;
+  quint64 m_misses = 0;
+};
+
+/**
+ * @brief Times rotation reads under each storage layout and chunk cache.
+ *
+ * Writes a synthetic 64 x 512 x 512 float cube per-frame chunked,
+ * frame-group chunked (8 frames per chunk) and contiguous into a scratch
+ * directory, then reads it slice by slice as rotation does with the chunk
+ * cache the pool would pick, the alternatives it replaces and none, and
+ * logs ms per frame (best of several passes).  The files stay in the page
+ * cache, so this measures HDF5 and the filters rather than the disk.
+ */
+void benchmarkRotationLayouts();
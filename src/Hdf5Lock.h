@@ -0,0 +1,16 @@
+// Hdf5Lock.h
+#pragma once
+
+#include <QMutex>
+
+/**
+ * @brief Process-wide lock around the HDF5 C library.
+ *
+ * The HDF5 we link against is not necessarily built thread-safe, so every
+ * thread that calls into it (loader, prefetch, background jobs) must hold
+ * this while it does.  Take it after any object-level mutex, never before.
+ */
+inline QMutex &hdf5Mutex() {
+  static QMutex mutex;
+  return mutex;
+}
@@ -0,0 +1,313 @@
+// ImageIndex.cpp
+#include "ImageIndex.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <algorithm>
+#include <cstring>
+
+#ifdef SWIFT_GUI_HAVE_INOTIFY
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kSignature[8] = {'\x89', 'H',  'D',    'F',
+                                '\r',   '\n', '\x1a', '\n'};
+
+// Largest user block we look behind for the signature
+constexpr qint64 kMaxUserBlock = qint64(64) * 1024;
+
+// Enough for every superblock field up to the end-of-file address
+constexpr qint64 kSuperblockBytes = 128;
+
+quint64 readAddress(const uchar *p, int size) {
+  quint64 value = 0;
+  for (int i = size - 1; i >= 0; --i)
+    value = (value << 8) | p[i];
+  return value;
+}
+
+/**
+ * @brief Checks the superblock at the start of @p block, read from
+ * @p offset (the user block size).
+ *
+ * Layouts from the HDF5 file format spec: versions 0/1 have the address
+ * size at byte 13 and the base, free-space, end-of-file addresses after 24
+ * (28 for version 1) bytes of fixed fields; versions 2/3 have it at byte 9,
+ * the consistency flags at byte 11, and base, extension, end-of-file
+ * addresses from byte 12.
+ */
+bool superblockComplete(const QByteArray &block, qint64 offset,
+                        qint64 fileSize) {
+  const uchar *p = reinterpret_cast<const uchar *>(block.constData());
+  const int n = int(block.size());
+  if (n < 16)
+    return false;
+
+  int offsetSize, addressesAt;
+  switch (p[8]) {
+  case 0:
+  case 1:
+    offsetSize = p[13];
+    addressesAt = p[8] == 0 ? 24 : 28;
+    break;
+  case 2:
+  case 3:
+    // bit 0: open for writing, bit 2: open by a SWMR writer
+    if (p[11] & 0x05)
+      return false;
+    offsetSize = p[9];
+    addressesAt = 12;
+    break;
+  default:
+    return false;
+  }
+  if (offsetSize != 2 && offsetSize != 4 && offsetSize != 8)
+    return false;
+  if (addressesAt + 3 * offsetSize > n)
+    return false;
+
+  // A closed file ends exactly at its end-of-file address.  While it is
+  // being written that address can lag behind or run ahead of the bytes on
+  // disk, so anything else is left to the stability poll.  The library
+  // stores it counting any user block; the spec has it relative to the
+  // superblock, so accept either.  All ones is the undefined address.
+  const quint64 undefined =
+      offsetSize == 8 ? ~quint64(0) : (quint64(1) << (8 * offsetSize)) - 1;
+  const quint64 eof =
+      readAddress(p + addressesAt + 2 * offsetSize, offsetSize);
+  if (eof == undefined || eof == 0)
+    return false;
+  return eof == quint64(fileSize) || eof + quint64(offset) == quint64(fileSize);
+}
+
+} // namespace
+
+ImageIndex::ImageIndex(QObject *parent) : QObject(parent) {
+  m_pollTimer.setInterval(kPollMs);
+  connect(&m_pollTimer, &QTimer::timeout, this, &ImageIndex::pollPending);
+  connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this,
+          &ImageIndex::probeNewFiles);
+}
+
+ImageIndex::~ImageIndex() { closeWatch(); }
+
+void ImageIndex::setDirectory(const QString &directory) {
+  closeWatch();
+  m_files.clear();
+  m_pending.clear();
+  m_pollTimer.stop();
+  m_latest = -1;
+  m_directory = directory;
+  if (m_directory.isEmpty())
+    return;
+
+  // Watch before listing, so a file closed in between is not missed
+#ifdef SWIFT_GUI_HAVE_INOTIFY
+  m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_inotifyFd >= 0)
+    m_watchFd = inotify_add_watch(m_inotifyFd,
+                                  QFile::encodeName(m_directory).constData(),
+                                  IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (m_watchFd >= 0) {
+    m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this,
+            &ImageIndex::readEvents);
+  } else {
+    qWarning() << "ImageIndex: cannot watch" << m_directory
+               << "with inotify, probing on directory changes instead.";
+    closeWatch();
+  }
+#endif
+  if (m_watchFd < 0)
+    m_watcher.addPath(m_directory);
+
+  // The one full listing
+  const QStringList names =
+      QDir(m_directory).entryList({"image_*.hdf5"}, QDir::Files);
+  int previous = -1;
+  for (const QString &name : names) {
+    int number = fileNumber(name);
+    if (number < 0)
+      continue;
+    m_files.insert(number);
+    if (number > m_latest) {
+      previous = m_latest;
+      m_latest = number;
+    } else {
+      previous = std::max(previous, number);
+    }
+  }
+
+  // Only the newest can still be being written
+  if (m_latest >= 0 && !hasCompleteSuperblock(path(m_latest))) {
+    m_files.remove(m_latest);
+    consider(m_latest, false);
+    m_latest = previous;
+  }
+  qDebug() << "ImageIndex:" << m_files.size() << "image files in"
+           << m_directory << "newest" << m_latest;
+}
+
+QList<int> ImageIndex::files() const {
+  QList<int> numbers(m_files.begin(), m_files.end());
+  std::sort(numbers.begin(), numbers.end());
+  return numbers;
+}
+
+int ImageIndex::fileNumber(const QString &fileName) {
+  static const QString prefix = QStringLiteral("image_");
+  static const QString suffix = QStringLiteral(".hdf5");
+  if (!fileName.startsWith(prefix) || !fileName.endsWith(suffix))
+    return -1;
+
+  const qsizetype digits = fileName.size() - prefix.size() - suffix.size();
+  if (digits <= 0)
+    return -1;
+  bool ok = false;
+  int number = fileName.mid(prefix.size(), digits).toInt(&ok);
+  return ok && number >= 0 ? number : -1;
+}
+
+bool ImageIndex::hasCompleteSuperblock(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  const qint64 size = file.size();
+  for (qint64 offset = 0; offset <= kMaxUserBlock && offset + 8 <= size;
+       offset = offset ? offset * 2 : 512) {
+    if (!file.seek(offset))
+      return false;
+    const QByteArray block = file.read(kSuperblockBytes);
+    if (block.size() >= 8 &&
+        std::memcmp(block.constData(), kSignature, sizeof(kSignature)) == 0)
+      return superblockComplete(block, offset, size);
+  }
+  return false;
+}
+
+/**
+ * @brief Drains the inotify queue.
+ */
+void ImageIndex::readEvents() {
+#ifdef SWIFT_GUI_HAVE_INOTIFY
+  alignas(inotify_event) char buf[4096];
+  bool overflow = false;
+  for (;;) {
+    ssize_t len = read(m_inotifyFd, buf, sizeof(buf));
+    if (len <= 0)
+      break;
+    for (const char *p = buf; p < buf + len;) {
+      const auto *event = reinterpret_cast<const inotify_event *>(p);
+      p += sizeof(inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW)
+        overflow = true;
+      if (event->len == 0)
+        continue;
+      int number = fileNumber(QFile::decodeName(event->name));
+      if (number >= 0)
+        consider(number, true);
+    }
+  }
+
+  // events were lost; pick up what we can by probing
+  if (overflow) {
+    qWarning() << "ImageIndex: inotify queue overflowed, probing for files.";
+    probeNewFiles();
+  }
+#endif
+}
+
+/**
+ * @brief Fallback: looks for the files numbered right after the newest.
+ *
+ * SWIFT numbers its images consecutively, so this finds every new file
+ * with one stat per file (plus one that fails).
+ */
+void ImageIndex::probeNewFiles() {
+  int newest = m_latest;
+  for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it)
+    newest = std::max(newest, it.key());
+  for (int number = newest + 1; QFileInfo::exists(path(number)); ++number)
+    consider(number, false);
+}
+
+/**
+ * @brief Accepts @p fileNumber now if it is known to be done, else queues
+ * it for the stability check.
+ *
+ * @p closed means its writer just closed it (or renamed it into place).
+ */
+void ImageIndex::consider(int fileNumber, bool closed) {
+  if (m_files.contains(fileNumber))
+    return;
+  if (closed && hasCompleteSuperblock(path(fileNumber))) {
+    m_pending.remove(fileNumber);
+    add(fileNumber);
+    return;
+  }
+  if (!m_pending.contains(fileNumber))
+    m_pending.insert(fileNumber, Pending());
+  if (!m_pollTimer.isActive())
+    m_pollTimer.start();
+}
+
+/**
+ * @brief Stability check of the files that are not known to be complete.
+ */
+void ImageIndex::pollPending() {
+  QList<int> ready;
+  for (auto it = m_pending.begin(); it != m_pending.end();) {
+    QFileInfo info(path(it.key()));
+    if (!info.exists()) {
+      it = m_pending.erase(it);
+      continue;
+    }
+    const qint64 size = info.size();
+    const qint64 mtimeMs = info.lastModified().toMSecsSinceEpoch();
+    const bool still = size == it->size && mtimeMs == it->mtimeMs;
+    it->size = size;
+    it->mtimeMs = mtimeMs;
+    if (still && hasCompleteSuperblock(info.filePath())) {
+      ready << it.key();
+      it = m_pending.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (m_pending.isEmpty())
+    m_pollTimer.stop();
+
+  std::sort(ready.begin(), ready.end());
+  for (int number : ready)
+    add(number);
+}
+
+void ImageIndex::add(int fileNumber) {
+  m_files.insert(fileNumber);
+  m_latest = std::max(m_latest, fileNumber);
+  emit fileAdded(fileNumber);
+}
+
+QString ImageIndex::path(int fileNumber) const {
+  return m_directory + QString("image_%1.hdf5").arg(fileNumber);
+}
+
+void ImageIndex::closeWatch() {
+  delete m_notifier;
+  m_notifier = nullptr;
+#ifdef SWIFT_GUI_HAVE_INOTIFY
+  if (m_inotifyFd >= 0)
+    ::close(m_inotifyFd); // drops the watch with it
+#endif
+  m_inotifyFd = m_watchFd = -1;
+  const QStringList watched = m_watcher.directories();
+  if (!watched.isEmpty())
+    m_watcher.removePaths(watched);
+}
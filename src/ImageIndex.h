@@ -0,0 +1,98 @@
+// ImageIndex.h
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+class QSocketNotifier;
+
+/**
+ * @brief Incremental index of the complete image_N.hdf5 files of a directory.
+ *
+ * The directory is listed once, when it is set.  After that every new file
+ * costs O(1): with inotify (SWIFT_GUI_HAVE_INOTIFY) the kernel names each
+ * file as SWIFT closes it (IN_CLOSE_WRITE) or renames it into place
+ * (IN_MOVED_TO); otherwise a QFileSystemWatcher change only probes the file
+ * numbers right after the newest one.
+ *
+ * A file is only announced once it is complete.  A closed file needs a
+ * good HDF5 superblock (see hasCompleteSuperblock()); anything else, say a
+ * file found by probing or one whose superblock is not written yet, is
+ * re-checked every kPollMs and accepted once its size and mtime held still
+ * between two checks and the superblock is good.
+ */
+class ImageIndex : public QObject {
+  Q_OBJECT
+public:
+  explicit ImageIndex(QObject *parent = nullptr);
+  ~ImageIndex() override;
+
+  /// Re-check period for files that are not known to be complete.
+  static constexpr int kPollMs = 1000;
+
+  /**
+   * @brief Index @p directory (ending in '/'), dropping the previous one.
+   *
+   * Files already there are taken as complete, except the newest, which
+   * SWIFT may still be writing.  An empty path just stops watching.
+   */
+  void setDirectory(const QString &directory);
+
+  /// Newest complete file number, -1 if none.
+  int latest() const { return m_latest; }
+
+  /// Every complete file number, ascending.
+  QList<int> files() const;
+
+  /// image_N.hdf5 → N, or -1 for any other name.
+  static int fileNumber(const QString &fileName);
+
+  /**
+   * @brief Whether @p path starts with a complete HDF5 superblock.
+   *
+   * The signature may sit after a user block (at 512, 1024, ...).  The
+   * superblock must be of a known version, version 2+ superblocks must not
+   * be flagged as open for writing, and the end-of-file address must be
+   * the file's size: a file still being written may record an address
+   * short of or past the bytes actually there.
+   */
+  static bool hasCompleteSuperblock(const QString &path);
+
+signals:
+  /// A new file is complete.  Not emitted for the files setDirectory() found.
+  void fileAdded(int fileNumber);
+
+private slots:
+  void readEvents();
+  void probeNewFiles();
+  void pollPending();
+
+private:
+  void consider(int fileNumber, bool closed);
+  void add(int fileNumber);
+  QString path(int fileNumber) const;
+  void closeWatch();
+
+  // size / mtime at the previous check; -1 until checked once
+  struct Pending {
+    qint64 size = -1;
+    qint64 mtimeMs = -1;
+  };
+
+  QString m_directory;
+  QSet<int> m_files;
+  int m_latest = -1;
+  QHash<int, Pending> m_pending;
+  QTimer m_pollTimer;
+
+  // inotify where available, else m_watcher
+  int m_inotifyFd = -1;
+  int m_watchFd = -1;
+  QSocketNotifier *m_notifier = nullptr;
+  QFileSystemWatcher m_watcher;
+};
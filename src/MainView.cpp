@@ -45,7 +45,7 @@ MainWindow::MainWindow(SimulationController *simCtrl,
   createProgressBar();
   createPlots();
   createDataWatcher();
-  createVisualisations();
+  createVisualisations(cmdParser);
   createSerialHandler("/dev/cu.usbmodem2101");
   createCounters();
 
@@ -59,6 +59,8 @@ MainWindow::MainWindow(SimulationController *simCtrl,
  * Shortcuts:
  *   - H/L/V/D : switch tabs (Home/Log/Visualise)
  *   - 0       : Dashboard (counter + progress bar)
+ *   - 5 / 6   : all four visualisations, 2x2 / 1x4 split screen
+ *   - T       : visualisation pipeline timings overlay
  *   - 7       : Wall-Clock Time plot (page 1)
  *   - 8       : Percent-Complete plot (page 2)
  *   - 9       : Particle-Counts plot (page 3)
@@ -129,6 +131,33 @@ void MainWindow::createActions() {
   });
   addAction(showGasTempViz);
 
+  // ─── Split screen: every field at once (5 = 2x2, 6 = 1x4) ────
+  QAction *showSplitGrid = new QAction(tr("Split Screen 2x2"), this);
+  showSplitGrid->setShortcut(QKeySequence(Qt::Key_5));
+  showSplitGrid->setShortcutContext(Qt::ApplicationShortcut);
+  connect(showSplitGrid, &QAction::triggered, this, [this] {
+    m_vizTab->toggleSplitView(2);
+    m_bottomWidget->setCurrentIndex(2);
+  });
+  addAction(showSplitGrid);
+
+  QAction *showSplitRow = new QAction(tr("Split Screen 1x4"), this);
+  showSplitRow->setShortcut(QKeySequence(Qt::Key_6));
+  showSplitRow->setShortcutContext(Qt::ApplicationShortcut);
+  connect(showSplitRow, &QAction::triggered, this, [this] {
+    m_vizTab->toggleSplitView(4);
+    m_bottomWidget->setCurrentIndex(2);
+  });
+  addAction(showSplitRow);
+
+  // ─── Pipeline timings overlay (T) ───────────────────────────
+  QAction *showTimings = new QAction(tr("Pipeline Timings"), this);
+  showTimings->setShortcut(QKeySequence(Qt::Key_T));
+  showTimings->setShortcutContext(Qt::ApplicationShortcut);
+  connect(showTimings, &QAction::triggered, this,
+          [this] { m_vizTab->toggleTimingsOverlay(); });
+  addAction(showTimings);
+
   // ─── Dashboard view shortcut (0) ─────────────────────────────
   QAction *showDashboard = new QAction(tr("Dashboard"), this);
   showDashboard->setShortcut(QKeySequence(Qt::Key_0));
@@ -370,8 +399,18 @@ void MainWindow::updateCurrentTimeLabel(double t) {
   m_currentLabel->setText(txt);
 }
 
-void MainWindow::createVisualisations() {
+void MainWindow::createVisualisations(CommandLineParser *cmdParser) {
   m_vizTab = new VizTabWidget(this);
+  m_vizTab->setHdf5PageBuffer(cmdParser->hdf5PageBufferBytes());
+  m_vizTab->setScrubDecimation(cmdParser->scrubDecimation());
+  m_vizTab->setFramePacks(cmdParser->framePacks());
+  QString timingsCsv = cmdParser->timingsCsvPath();
+  if (timingsCsv.isEmpty())
+    timingsCsv = m_simCtrl->simulationDirectory() + "/stage_timings.csv";
+  m_vizTab->setTimingsCsv(timingsCsv);
+  const QHash<QString, QString> stretches = cmdParser->stretches();
+  for (auto it = stretches.cbegin(); it != stretches.cend(); ++it)
+    m_vizTab->setStretch(it.key(), it.value());
   m_bottomWidget->addWidget(m_vizTab);
   QString imagesDir = m_simCtrl->simulationDirectory() + "/images";
   m_vizTab->watchImageDirectory(imagesDir);
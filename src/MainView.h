@@ -42,7 +42,7 @@ private:
   void createsBottom(CommandLineParser *cmdParser);
   void createProgressBar();
   void createPlots();
-  void createVisualisations();
+  void createVisualisations(CommandLineParser *cmdParser);
   void createDataWatcher();
   void createCounters();
 
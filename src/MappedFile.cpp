@@ -0,0 +1,81 @@
+// MappedFile.cpp
+#include "MappedFile.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+size_t pageSize() {
+  static const size_t page = size_t(sysconf(_SC_PAGESIZE));
+  return page;
+}
+} // namespace
+
+MappedFile::~MappedFile() { unmap(); }
+
+bool MappedFile::map(const QString &path, size_t offset, size_t bytes) {
+  unmap();
+  if (bytes == 0)
+    return false;
+
+  int fd = ::open(path.toUtf8().constData(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  // a short (still being written or truncated) file would SIGBUS later
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < offset + bytes) {
+    ::close(fd);
+    return false;
+  }
+
+  const size_t aligned = offset / pageSize() * pageSize();
+  const size_t length = offset - aligned + bytes;
+  void *p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, off_t(aligned));
+  ::close(fd); // the mapping keeps its own reference
+  if (p == MAP_FAILED)
+    return false;
+
+#ifdef MADV_SEQUENTIAL
+  // rotation walks the frames in file order
+  madvise(p, length, MADV_SEQUENTIAL);
+#endif
+
+  m_path = path;
+  m_mapping = p;
+  m_mapped = length;
+  m_data = static_cast<const char *>(p) + (offset - aligned);
+  m_size = bytes;
+  return true;
+}
+
+void MappedFile::unmap() {
+  if (m_mapping)
+    munmap(m_mapping, m_mapped);
+  m_path.clear();
+  m_mapping = nullptr;
+  m_mapped = 0;
+  m_data = nullptr;
+  m_size = 0;
+}
+
+void MappedFile::willNeed(size_t offset, size_t bytes) const {
+#ifdef MADV_WILLNEED
+  if (!m_data || offset >= m_size)
+    return;
+  bytes = std::min(bytes, m_size - offset);
+
+  // madvise wants a page-aligned start
+  const char *begin = m_data + offset;
+  const char *start = static_cast<const char *>(m_mapping) +
+                      size_t(begin - static_cast<const char *>(m_mapping)) /
+                          pageSize() * pageSize();
+  madvise(const_cast<char *>(start), size_t(begin - start) + bytes,
+          MADV_WILLNEED);
+#else
+  (void)offset;
+  (void)bytes;
+#endif
+}
@@ -0,0 +1,47 @@
+// MappedFile.h
+#pragma once
+
+#include <QString>
+#include <cstddef>
+
+/**
+ * @brief Read-only memory map of a byte range of a file.
+ *
+ * Used for contiguous, unfiltered HDF5 datasets: H5Dget_offset() gives the
+ * raw data's file offset, so every rotation frame is just a pointer into
+ * the page cache and no H5Dread is needed.  Hints are passed on to the
+ * kernel with madvise() where the platform has it.
+ */
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /**
+   * @brief Map @p bytes of @p path starting at @p offset, unmapping any
+   * previous range.  Fails if the file is shorter than the range.
+   */
+  bool map(const QString &path, size_t offset, size_t bytes);
+
+  /// Unmap (no-op when nothing is mapped).
+  void unmap();
+
+  /// Start of the requested range (not of the page-aligned mapping).
+  const void *data() const { return m_data; }
+  size_t size() const { return m_size; }
+  bool isNull() const { return m_data == nullptr; }
+  const QString &path() const { return m_path; }
+
+  /// Ask the kernel to read [offset, offset + bytes) of the range ahead.
+  void willNeed(size_t offset, size_t bytes) const;
+
+private:
+  QString m_path;
+  const char *m_data = nullptr;
+  void *m_mapping = nullptr; ///< page-aligned start of the mapping
+  size_t m_mapped = 0;
+  size_t m_size = 0;
+};
@@ -0,0 +1,230 @@
+// NormalizationCache.cpp
+#include "NormalizationCache.h"
+#include "Hdf5Lock.h"
+#include "PercentileEngine.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QTextStream>
+#include <hdf5.h>
+#include <vector>
+
+NormalizationCache::NormalizationCache(QObject *parent)
+    : QObject(parent), m_saveTimer(new QTimer(this)) {
+  // Same defaults as the loader
+  for (const char *dataset :
+       {"dark_matter", "gas", "stars", "gas_temperature"})
+    m_percentiles.insert(dataset, qMakePair(5.0f, 99.99f));
+
+  m_saveTimer->setSingleShot(true);
+  m_saveTimer->setInterval(2000);
+  connect(m_saveTimer, &QTimer::timeout, this, &NormalizationCache::save);
+}
+
+NormalizationCache::~NormalizationCache() { save(); }
+
+QString NormalizationCache::entryKey(int fileNumber, const QString &dataset,
+                                     float percentileLow,
+                                     float percentileHigh) {
+  // 9 significant digits round-trip a float exactly
+  return QString("%1/%2/%3/%4")
+      .arg(fileNumber)
+      .arg(dataset)
+      .arg(double(percentileLow), 0, 'g', 9)
+      .arg(double(percentileHigh), 0, 'g', 9);
+}
+
+bool NormalizationCache::lookup(int fileNumber, const QString &filePath,
+                                const QString &dataset, float percentileLow,
+                                float percentileHigh, float &lower,
+                                float &upper) const {
+  QFileInfo info(filePath);
+  if (!info.exists())
+    return false;
+
+  QMutexLocker lock(&m_mutex);
+  auto it = m_entries.constFind(
+      entryKey(fileNumber, dataset, percentileLow, percentileHigh));
+  if (it == m_entries.constEnd() ||
+      it->mtimeMs != info.lastModified().toMSecsSinceEpoch() ||
+      it->size != info.size())
+    return false;
+
+  lower = it->lower;
+  upper = it->upper;
+  return true;
+}
+
+void NormalizationCache::insert(int fileNumber, const QString &filePath,
+                                const QString &dataset, float percentileLow,
+                                float percentileHigh, float lower,
+                                float upper) {
+  QFileInfo info(filePath);
+  Entry entry;
+  entry.mtimeMs = info.lastModified().toMSecsSinceEpoch();
+  entry.size = info.size();
+  entry.lower = lower;
+  entry.upper = upper;
+
+  QMutexLocker lock(&m_mutex);
+  m_entries.insert(entryKey(fileNumber, dataset, percentileLow, percentileHigh),
+                   entry);
+  m_dirty = true;
+
+  // the timer belongs to our thread; poke it from there
+  QMetaObject::invokeMethod(
+      m_saveTimer, [this] { m_saveTimer->start(); }, Qt::QueuedConnection);
+}
+
+void NormalizationCache::setPercentiles(const QString &dataset, float low,
+                                        float high) {
+  QMutexLocker lock(&m_mutex);
+  m_percentiles.insert(dataset, qMakePair(low, high));
+}
+
+QHash<QString, QPair<float, float>> NormalizationCache::percentiles() const {
+  QMutexLocker lock(&m_mutex);
+  return m_percentiles;
+}
+
+void NormalizationCache::setDirectory(const QString &imageDirectory) {
+  {
+    QMutexLocker lock(&m_mutex);
+    if (imageDirectory == m_imageDirectory)
+      return;
+  }
+  save();
+
+  QMutexLocker lock(&m_mutex);
+  m_imageDirectory = imageDirectory;
+  m_entries.clear();
+  m_dirty = false;
+  load();
+}
+
+/**
+ * @brief Reads slice 0 of each dataset and stores its percentile bounds.
+ *
+ * HDF5 is only locked while reading, so the loader is held up for at most
+ * one slice read at a time; binning runs unlocked on this thread.
+ */
+void NormalizationCache::precompute(int fileNumber) {
+  QString path;
+  QHash<QString, QPair<float, float>> wanted;
+  {
+    QMutexLocker lock(&m_mutex);
+    if (m_imageDirectory.isEmpty())
+      return;
+    path = m_imageDirectory + QString("image_%1.hdf5").arg(fileNumber);
+    wanted = m_percentiles;
+  }
+
+  std::vector<float> buf;
+  PercentileEngine histogram;
+  hid_t fileId = -1;
+  for (auto it = wanted.constBegin(); it != wanted.constEnd(); ++it) {
+    float lower, upper;
+    if (lookup(fileNumber, path, it.key(), it->first, it->second, lower,
+               upper))
+      continue;
+
+    {
+      QMutexLocker h5(&hdf5Mutex());
+      if (fileId < 0)
+        fileId =
+            H5Fopen(path.toUtf8().constData(), H5F_ACC_RDONLY, H5P_DEFAULT);
+      if (fileId < 0)
+        return;
+      hid_t dsetId =
+          H5Dopen2(fileId, it.key().toUtf8().constData(), H5P_DEFAULT);
+      if (dsetId < 0)
+        continue;
+      hid_t fileSpace = H5Dget_space(dsetId);
+      hsize_t fullDims[3];
+      H5Sget_simple_extent_dims(fileSpace, fullDims, nullptr);
+      hsize_t offset[3] = {0, 0, 0};
+      hsize_t count[3] = {1, fullDims[1], fullDims[2]};
+      hid_t memSpace = H5Screate_simple(3, count, nullptr);
+      H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr, count,
+                          nullptr);
+      buf.resize(size_t(fullDims[1]) * fullDims[2]);
+      herr_t status = H5Dread(dsetId, H5T_NATIVE_FLOAT, memSpace, fileSpace,
+                              H5P_DEFAULT, buf.data());
+      H5Sclose(memSpace);
+      H5Sclose(fileSpace);
+      H5Dclose(dsetId);
+      if (status < 0)
+        continue;
+    }
+
+    // bin without holding HDF5
+    histogram.build(buf.data(), buf.size());
+    std::vector<float> values =
+        histogram.percentiles({it->first, it->second});
+    lower = values[0];
+    upper = values[1];
+    if (lower == upper) {
+      lower = histogram.minValue();
+      upper = histogram.maxValue();
+    }
+    insert(fileNumber, path, it.key(), it->first, it->second, lower, upper);
+  }
+
+  if (fileId >= 0) {
+    QMutexLocker h5(&hdf5Mutex());
+    H5Fclose(fileId);
+  }
+}
+
+void NormalizationCache::save() {
+  QMutexLocker lock(&m_mutex);
+  if (!m_dirty || m_imageDirectory.isEmpty())
+    return;
+
+  QSaveFile file(m_imageDirectory + kSidecarName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    qWarning() << "NormalizationCache: cannot write" << file.fileName();
+    return;
+  }
+
+  // file, dataset, pctLow, pctHigh, mtime, size, lower, upper
+  QTextStream out(&file);
+  for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+    QStringList parts = it.key().split('/');
+    out << parts.join('\t') << '\t' << it->mtimeMs << '\t' << it->size << '\t'
+        << QString::number(double(it->lower), 'g', 9) << '\t'
+        << QString::number(double(it->upper), 'g', 9) << '\n';
+  }
+  out.flush();
+  if (file.commit())
+    m_dirty = false;
+}
+
+/**
+ * @brief Reads the sidecar.  Caller must hold m_mutex.
+ */
+void NormalizationCache::load() {
+  QFile file(m_imageDirectory + kSidecarName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return;
+
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    QStringList parts = in.readLine().split('\t');
+    if (parts.size() != 8)
+      continue;
+    Entry entry;
+    entry.mtimeMs = parts[4].toLongLong();
+    entry.size = parts[5].toLongLong();
+    entry.lower = parts[6].toFloat();
+    entry.upper = parts[7].toFloat();
+    m_entries.insert(QString("%1/%2/%3/%4")
+                         .arg(parts[0], parts[1], parts[2], parts[3]),
+                     entry);
+  }
+  qDebug() << "NormalizationCache: loaded" << m_entries.size()
+           << "entries from" << file.fileName();
+}
@@ -0,0 +1,77 @@
+// NormalizationCache.h
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+/**
+ * @brief Persistent cache of per-file normalization bounds.
+ *
+ * Entries are keyed by (file number, dataset, percentile pair) and remember
+ * the file's mtime and size, so a rewritten file is treated as a miss.  The
+ * cache is kept in memory and mirrored to a sidecar file in the images
+ * directory, so restarts start warm.
+ *
+ * The object lives in its own low-priority thread: precompute() reads slice
+ * 0 of every dataset of a file and bins it, for the percentile pairs set
+ * with setPercentiles().  lookup()/insert() are thread-safe and can be
+ * called from the loader.
+ */
+class NormalizationCache : public QObject {
+  Q_OBJECT
+public:
+  explicit NormalizationCache(QObject *parent = nullptr);
+  ~NormalizationCache() override;
+
+  /// Name of the sidecar written into the images directory.
+  static constexpr const char *kSidecarName = "normalization_cache.tsv";
+
+  /// Look up the bounds for a dataset of @p filePath.  Thread-safe.
+  bool lookup(int fileNumber, const QString &filePath, const QString &dataset,
+              float percentileLow, float percentileHigh, float &lower,
+              float &upper) const;
+
+  /// Record freshly computed bounds.  Thread-safe.
+  void insert(int fileNumber, const QString &filePath, const QString &dataset,
+              float percentileLow, float percentileHigh, float lower,
+              float upper);
+
+  /// Percentile pair the background job should compute for @p dataset.
+  void setPercentiles(const QString &dataset, float low, float high);
+
+  /// Every dataset's percentile pair (dataset → (low, high)).  Thread-safe.
+  QHash<QString, QPair<float, float>> percentiles() const;
+
+public slots:
+  /// Switch to (and load the sidecar of) a new images directory.
+  void setDirectory(const QString &imageDirectory);
+
+  /// Fill the cache for image_<fileNumber>.hdf5, if not already there.
+  void precompute(int fileNumber);
+
+  /// Write the sidecar now if anything changed.
+  void save();
+
+private:
+  struct Entry {
+    qint64 mtimeMs = 0;
+    qint64 size = 0;
+    float lower = 0.0f;
+    float upper = 1.0f;
+  };
+
+  static QString entryKey(int fileNumber, const QString &dataset,
+                          float percentileLow, float percentileHigh);
+  void load();
+
+  mutable QMutex m_mutex; // guards everything below
+  QString m_imageDirectory;
+  QHash<QString, Entry> m_entries;
+  QHash<QString, QPair<float, float>> m_percentiles; // dataset → (low, high)
+  bool m_dirty = false;
+
+  QTimer *m_saveTimer; // debounces sidecar writes
+};
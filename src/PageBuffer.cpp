@@ -0,0 +1,60 @@
+// PageBuffer.cpp
+#include "PageBuffer.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t kHugePageSize = size_t(2) * 1024 * 1024;
+
+size_t roundUp(size_t bytes, size_t alignment) {
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+PageBuffer::~PageBuffer() { release(); }
+
+bool PageBuffer::allocate(size_t bytes) {
+  release();
+  if (bytes == 0)
+    return false;
+
+#ifdef MAP_HUGETLB
+  // Explicit huge pages only succeed if the admin reserved some
+  size_t hugeBytes = roundUp(bytes, kHugePageSize);
+  void *p = mmap(nullptr, hugeBytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED) {
+    m_data = p;
+    m_size = bytes;
+    m_mapped = hugeBytes;
+    m_hugePages = true;
+    return true;
+  }
+#endif
+
+  size_t pageBytes = roundUp(bytes, size_t(sysconf(_SC_PAGESIZE)));
+  void *q = mmap(nullptr, pageBytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (q == MAP_FAILED)
+    return false;
+
+#ifdef MADV_HUGEPAGE
+  // Transparent huge pages; harmless if THP is disabled
+  madvise(q, pageBytes, MADV_HUGEPAGE);
+#endif
+
+  m_data = q;
+  m_size = bytes;
+  m_mapped = pageBytes;
+  m_hugePages = false;
+  return true;
+}
+
+void PageBuffer::release() {
+  if (m_data)
+    munmap(m_data, m_mapped);
+  m_data = nullptr;
+  m_size = 0;
+  m_mapped = 0;
+  m_hugePages = false;
+}
@@ -0,0 +1,48 @@
+// PageBuffer.h
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+/**
+ * @brief Page-aligned, anonymously mapped memory block.
+ *
+ * Used to hold a whole rotation volume.  On Linux we first try explicit huge
+ * pages (MAP_HUGETLB) and otherwise ask for transparent huge pages with
+ * madvise(MADV_HUGEPAGE); elsewhere we fall back to ordinary pages.
+ */
+class PageBuffer {
+public:
+  PageBuffer() = default;
+  ~PageBuffer();
+
+  PageBuffer(const PageBuffer &) = delete;
+  PageBuffer &operator=(const PageBuffer &) = delete;
+
+  /// Map at least @p bytes, releasing any previous block.  False on failure.
+  bool allocate(size_t bytes);
+
+  /// Unmap the block (no-op when empty).
+  void release();
+
+  void *data() const { return m_data; }
+  size_t size() const { return m_size; }
+  bool isNull() const { return m_data == nullptr; }
+
+  /// True when the block is backed by explicit huge pages.
+  bool hugePages() const { return m_hugePages; }
+
+  /// Exchange blocks, e.g. to install one filled elsewhere.
+  void swap(PageBuffer &other) noexcept {
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_mapped, other.m_mapped);
+    std::swap(m_hugePages, other.m_hugePages);
+  }
+
+private:
+  void *m_data = nullptr;
+  size_t m_size = 0;      ///< Requested size in bytes
+  size_t m_mapped = 0;    ///< Mapped (rounded up) size in bytes
+  bool m_hugePages = false;
+};
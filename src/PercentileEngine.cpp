@@ -0,0 +1,187 @@
+// PercentileEngine.cpp
+#include "PercentileEngine.h"
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+/// Order-preserving map from float to uint32 (negatives flipped).
+inline quint32 sortableKey(float v) {
+  quint32 bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+inline float fromSortableKey(quint32 key) {
+  quint32 bits = (key & 0x80000000u) ? (key & 0x7fffffffu) : ~key;
+  float v;
+  std::memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+// Bin holding +0.0; -0.0 is folded into it as well
+constexpr int kZeroBin =
+    int(0x80000000u >> (32 - PercentileEngine::kBinBits));
+
+struct ChunkResult {
+  std::vector<quint32> bins;
+  size_t count = 0;
+  size_t zeros = 0;
+  float min = std::numeric_limits<float>::max();
+  float max = std::numeric_limits<float>::lowest();
+};
+
+void histogramChunk(const float *data, size_t n, ChunkResult &out) {
+  out.bins.assign(PercentileEngine::kBins, 0);
+  for (size_t i = 0; i < n; ++i) {
+    float v = data[i];
+    if (std::isnan(v))
+      continue;
+    if (v == 0.0f) {
+      ++out.bins[kZeroBin];
+      ++out.zeros;
+    } else {
+      ++out.bins[sortableKey(v) >> (32 - PercentileEngine::kBinBits)];
+    }
+    ++out.count;
+    out.min = std::min(out.min, v);
+    out.max = std::max(out.max, v);
+  }
+}
+
+} // namespace
+
+void PercentileEngine::clear() {
+  m_bins.clear();
+  m_data.clear();
+  m_count = 0;
+  m_zeros = 0;
+  m_min = 0.0f;
+  m_max = 0.0f;
+}
+
+void PercentileEngine::build(const float *data, size_t n, QThreadPool *pool,
+                             int threads, bool exact) {
+  clear();
+  if (!data || n == 0)
+    return;
+
+  // don't bother splitting small inputs
+  constexpr size_t kMinChunk = size_t(1) << 18;
+  int chunks = pool ? int(std::min<size_t>(std::max(threads, 1),
+                                           (n + kMinChunk - 1) / kMinChunk))
+                    : 1;
+
+  std::vector<ChunkResult> results(chunks);
+  auto runChunk = [&](int c) {
+    size_t begin = n * c / chunks;
+    size_t end = n * (c + 1) / chunks;
+    histogramChunk(data + begin, end - begin, results[c]);
+  };
+
+  QSemaphore done;
+  for (int c = 1; c < chunks; ++c) {
+    pool->start([&, c] {
+      runChunk(c);
+      done.release();
+    });
+  }
+  runChunk(0);
+  done.acquire(chunks - 1);
+
+  // merge
+  m_bins = std::move(results[0].bins);
+  m_count = results[0].count;
+  m_zeros = results[0].zeros;
+  m_min = results[0].min;
+  m_max = results[0].max;
+  for (int c = 1; c < chunks; ++c) {
+    const ChunkResult &r = results[c];
+    for (int b = 0; b < kBins; ++b)
+      m_bins[b] += r.bins[b];
+    m_count += r.count;
+    m_zeros += r.zeros;
+    m_min = std::min(m_min, r.min);
+    m_max = std::max(m_max, r.max);
+  }
+
+  if (m_count == 0) {
+    clear();
+    return;
+  }
+  if (exact)
+    m_data.assign(data, data + n);
+}
+
+float PercentileEngine::percentile(float percent) const {
+  return percentiles({percent}).front();
+}
+
+std::vector<float>
+PercentileEngine::percentiles(const std::vector<float> &percents) const {
+  std::vector<float> values(percents.size(), 0.0f);
+  if (isEmpty())
+    return values;
+
+  // ranks, visited in ascending order so we walk the bins once
+  std::vector<size_t> ranks(percents.size());
+  for (size_t i = 0; i < percents.size(); ++i) {
+    size_t rank = size_t((percents[i] / 100.f) * (m_count - 1) + .5f);
+    ranks[i] = std::min(rank, m_count - 1);
+  }
+  std::vector<size_t> order(percents.size());
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return ranks[a] < ranks[b]; });
+
+  size_t cumulative = 0;
+  int bin = 0;
+  for (size_t i : order) {
+    while (cumulative + m_bins[bin] <= ranks[i]) {
+      cumulative += m_bins[bin];
+      ++bin;
+    }
+    values[i] = valueAtRank(ranks[i], bin, ranks[i] - cumulative);
+  }
+  return values;
+}
+
+float PercentileEngine::valueAtRank(size_t rank, int bin,
+                                    size_t rankInBin) const {
+  if (rank == 0)
+    return m_min;
+  if (rank == m_count - 1)
+    return m_max;
+
+  const quint32 lowKey = quint32(bin) << (32 - kBinBits);
+
+  // exact: select among the members of this bin only
+  if (!m_data.empty()) {
+    std::vector<float> members;
+    members.reserve(m_bins[bin]);
+    for (float v : m_data) {
+      int memberBin =
+          v == 0.0f ? kZeroBin : int(sortableKey(v) >> (32 - kBinBits));
+      if (!std::isnan(v) && memberBin == bin)
+        members.push_back(v);
+    }
+    std::nth_element(members.begin(), members.begin() + rankInBin,
+                     members.end());
+    return members[rankInBin];
+  }
+
+  // zeros (usually empty background) are the smallest members of their bin
+  if (bin == kZeroBin && rankInBin < m_zeros)
+    return 0.0f;
+
+  // approximate: spread the bin's members evenly over its key range
+  const double binWidth = double(1u << (32 - kBinBits));
+  double offset = (double(rankInBin) + 0.5) / double(m_bins[bin]) * binWidth;
+  float v = fromSortableKey(lowKey + quint32(offset));
+  return std::clamp(v, m_min, m_max);
+}
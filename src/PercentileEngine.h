@@ -0,0 +1,64 @@
+// PercentileEngine.h
+#pragma once
+
+#include <QtGlobal>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class QThreadPool;
+
+/**
+ * @brief Single-pass, log-binned histogram for answering percentile queries.
+ *
+ * Every float maps to an order-preserving 32-bit key; the top 16 bits of
+ * that key pick the bin, so bins are logarithmic (1/128 of an octave wide)
+ * over the whole float range and no min/max pre-pass is needed.  Building
+ * runs in parallel over chunks; afterwards any number of percentiles can be
+ * read off the cumulative counts in microseconds.
+ *
+ * Answers are interpolated inside the target bin (< 0.6% relative error).
+ * With exact refinement enabled the engine keeps a copy of the data and
+ * selects the exact rank from the members of the target bin only.
+ */
+class PercentileEngine {
+public:
+  static constexpr int kBinBits = 16;
+  static constexpr int kBins = 1 << kBinBits;
+
+  /**
+   * @brief Build the histogram from @p n values.
+   * @param pool     Pool to spread chunks over (nullptr = serial)
+   * @param threads  Max threads to use, including the caller
+   * @param exact    Keep a copy of the data for exact refinement
+   */
+  void build(const float *data, size_t n, QThreadPool *pool = nullptr,
+             int threads = 1, bool exact = false);
+
+  void clear();
+  bool isEmpty() const { return m_count == 0; }
+  size_t count() const { return m_count; }
+
+  /// Smallest / largest value seen (NaNs are ignored).
+  float minValue() const { return m_min; }
+  float maxValue() const { return m_max; }
+
+  /**
+   * @brief Value at @p percent (0–100), using the same rank rule as the old
+   * nth_element code: rank = round(percent / 100 * (n - 1)).
+   */
+  float percentile(float percent) const;
+
+  /// Several percentiles at once; one walk over the cumulative counts.
+  std::vector<float> percentiles(const std::vector<float> &percents) const;
+
+private:
+  float valueAtRank(size_t rank, int bin, size_t rankInBin) const;
+
+  std::vector<quint32> m_bins; // counts per bin
+  std::vector<float> m_data;   // only kept for exact refinement
+  size_t m_count = 0;
+  size_t m_zeros = 0; // exact zeros, tracked so background stays exactly 0
+  float m_min = 0.0f;
+  float m_max = 0.0f;
+};
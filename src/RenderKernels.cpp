@@ -0,0 +1,275 @@
+// RenderKernels.cpp
+#include "RenderKernels.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+const char *indexDomainName(IndexDomain domain) {
+  return domain == IndexDomain::Log2 ? "log2" : "linear";
+}
+
+template <IndexDomain D>
+void renderRowScalar(const float *src, uint32_t *dst, int n,
+                     const RenderParams &params) {
+  for (int x = 0; x < n; ++x)
+    dst[x] = renderPixel<D>(src[x], params);
+}
+
+template void renderRowScalar<IndexDomain::Linear>(const float *, uint32_t *,
+                                                   int, const RenderParams &);
+template void renderRowScalar<IndexDomain::Log2>(const float *, uint32_t *,
+                                                 int, const RenderParams &);
+
+void resampleRowScalar(const float *r0, const float *r1, float w, int n,
+                       const ResampleTaps &taps, float *blended, float *out) {
+  for (int x = 0; x < n; ++x)
+    blended[x] = lerpSample(r0[x], r1[x], w);
+  for (int y = 0; y < taps.n; ++y)
+    out[y] = lerpSample(blended[taps.i0[y]], blended[taps.i1[y]], taps.w[y]);
+}
+
+namespace {
+
+/// One instruction set's kernels, render ones indexed by IndexDomain.
+struct KernelChoice {
+  RenderRowFn fn[kIndexDomains];
+  ResampleRowFn resample;
+  const char *name;
+};
+
+/// Lo/hi normalization bounds on @p D's axis, as the loader sets them.
+template <IndexDomain D>
+RenderParams testParams(float lo, float hi, const std::vector<uint32_t> &lut) {
+  RenderParams params;
+  params.min = indexValue<D>(lo);
+  params.scale = float(lut.size()) / (indexValue<D>(hi) - params.min);
+  params.maxIndex = float(lut.size() - 1);
+  params.lut = lut.data();
+  return params;
+}
+
+/**
+ * @brief Compares @p fn with the scalar kernel on awkward synthetic rows.
+ *
+ * Covers background, values below min and above max, exact bin edges,
+ * NaN/inf and every tail length up to one AVX-512 vector.
+ */
+template <IndexDomain D> bool matchesScalar(RenderRowFn fn) {
+  // small LUT whose entries are all distinct
+  std::vector<uint32_t> lut(4096);
+  for (size_t i = 0; i < lut.size(); ++i)
+    lut[i] = 0xff000000u | uint32_t(i * 2654435761u >> 8);
+
+  const RenderParams params = testParams<D>(0.25f, 3.75f, lut);
+
+  std::vector<float> src;
+  uint32_t state = 12345u;
+  for (int i = 0; i < 4099; ++i) {
+    state = state * 1664525u + 1013904223u;
+    src.push_back((float(state >> 8) / float(1 << 24)) * 5.0f - 1.0f);
+  }
+  const float specials[] = {0.0f,
+                            -0.0f,
+                            0.25f,
+                            3.75f,
+                            1e30f,
+                            -1e30f,
+                            std::numeric_limits<float>::min(),
+                            std::numeric_limits<float>::infinity(),
+                            std::numeric_limits<float>::quiet_NaN()};
+  for (float v : specials)
+    src.push_back(v);
+  for (int i = 0; i < 64; ++i) // exact bin edges (of the linear axis)
+    src.push_back(0.25f + float(i * 61) * 3.5f / float(lut.size()));
+
+  std::vector<uint32_t> expected(src.size()), actual(src.size());
+  for (int len = 1; len <= 17; ++len) {
+    for (size_t start = 0; start + len <= src.size(); start += len) {
+      renderRowScalar<D>(src.data() + start, expected.data() + start, len,
+                         params);
+      fn(src.data() + start, actual.data() + start, len, params);
+    }
+    if (std::memcmp(expected.data(), actual.data(),
+                    (src.size() / len) * len * sizeof(uint32_t)) != 0)
+      return false;
+  }
+  renderRowScalar<D>(src.data(), expected.data(), int(src.size()), params);
+  fn(src.data(), actual.data(), int(src.size()), params);
+  return expected == actual;
+}
+
+/// Bilinear taps from @p src to @p out samples, as the loader builds them.
+void testTaps(int src, int out, std::vector<int> &i0, std::vector<int> &i1,
+              std::vector<float> &w) {
+  i0.resize(size_t(out));
+  i1.resize(size_t(out));
+  w.resize(size_t(out));
+  const double scale = double(src) / out;
+  for (int i = 0; i < out; ++i) {
+    double pos = std::clamp((i + 0.5) * scale - 0.5, 0.0, double(src - 1));
+    i0[size_t(i)] = int(pos);
+    i1[size_t(i)] = std::min(int(pos) + 1, src - 1);
+    w[size_t(i)] = float(pos - int(pos));
+  }
+}
+
+/**
+ * @brief Compares @p fn with resampleRowScalar() up and down in size.
+ *
+ * Covers every row length up to two AVX-512 vectors, on both sides of
+ * each, with values that make the rounding of the blend show.
+ */
+bool resampleMatchesScalar(ResampleRowFn fn) {
+  std::vector<float> r0(64), r1(64);
+  uint32_t state = 2463534242u;
+  for (size_t i = 0; i < r0.size(); ++i) {
+    state = state * 1664525u + 1013904223u;
+    r0[i] = std::exp2(float(state >> 8) / float(1 << 20) - 8.0f);
+    r1[i] = float(i % 3) - r0[i] / 3.0f;
+  }
+  std::vector<int> i0, i1;
+  std::vector<float> w;
+  std::vector<float> blendedA(64), blendedB(64), outA(96), outB(96);
+  for (int n = 1; n <= 33; ++n) {
+    for (int out : {1, n / 2 + 1, n, n + 7, 3 * n - 1}) {
+      testTaps(n, out, i0, i1, w);
+      const ResampleTaps taps{i0.data(), i1.data(), w.data(), out};
+      const float wx = float(n) / 37.0f;
+      resampleRowScalar(r0.data(), r1.data(), wx, n, taps, blendedA.data(),
+                        outA.data());
+      fn(r0.data(), r1.data(), wx, n, taps, blendedB.data(), outB.data());
+      if (std::memcmp(outA.data(), outB.data(), size_t(out) * sizeof(float)))
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Every kernel family the running CPU supports, fastest first.
+std::vector<KernelChoice> supportedKernels() {
+  std::vector<KernelChoice> kernels;
+#ifdef SWIFT_GUI_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    kernels.push_back({{renderRowAvx512<IndexDomain::Linear>,
+                        renderRowAvx512<IndexDomain::Log2>},
+                       resampleRowAvx512,
+                       "AVX-512"});
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back({{renderRowAvx2<IndexDomain::Linear>,
+                        renderRowAvx2<IndexDomain::Log2>},
+                       resampleRowAvx2,
+                       "AVX2"});
+  if (__builtin_cpu_supports("sse4.2"))
+    kernels.push_back({{renderRowSse42<IndexDomain::Linear>,
+                        renderRowSse42<IndexDomain::Log2>},
+                       resampleRowSse42,
+                       "SSE4.2"});
+#endif
+  kernels.push_back({{renderRowScalar<IndexDomain::Linear>,
+                      renderRowScalar<IndexDomain::Log2>},
+                     resampleRowScalar,
+                     "scalar"});
+  return kernels;
+}
+
+KernelChoice selectKernel() {
+  const std::vector<KernelChoice> kernels = supportedKernels();
+  for (const KernelChoice &c : kernels) {
+    if (matchesScalar<IndexDomain::Linear>(c.fn[0]) &&
+        matchesScalar<IndexDomain::Log2>(c.fn[1]) &&
+        resampleMatchesScalar(c.resample))
+      return c;
+    qWarning() << "RenderKernels:" << c.name
+               << "kernel disagrees with the scalar path, skipping.";
+  }
+  return kernels.back();
+}
+
+const KernelChoice &kernel() {
+  static const KernelChoice choice = [] {
+    KernelChoice c = selectKernel();
+    qDebug() << "RenderKernels: using" << c.name << "render kernel.";
+    return c;
+  }();
+  return choice;
+}
+
+} // namespace
+
+RenderRowFn renderRowKernel(IndexDomain domain) {
+  return kernel().fn[int(domain)];
+}
+
+ResampleRowFn resampleRowKernel() { return kernel().resample; }
+
+const char *renderRowKernelName() { return kernel().name; }
+
+void benchmarkRenderKernels() {
+  constexpr int kWidth = 4096;
+  constexpr int kRows = 512;
+  constexpr int kRuns = 7;
+
+  // a 16K-entry LUT and a log-normal-ish field with empty pixels, like the
+  // density images; the output stays in cache so we time the kernel alone
+  std::vector<uint32_t> lut(16384);
+  for (size_t i = 0; i < lut.size(); ++i)
+    lut[i] = 0xff000000u | uint32_t(i * 2654435761u >> 8);
+  std::vector<float> src(size_t(kWidth) * kRows);
+  uint32_t state = 12345u;
+  for (float &v : src) {
+    state = state * 1664525u + 1013904223u;
+    float u = float(state >> 8) / float(1 << 24);
+    v = u < 0.1f ? 0.0f : std::exp2(24.0f * u - 8.0f);
+  }
+  std::vector<uint32_t> dst(kWidth);
+
+  for (const KernelChoice &c : supportedKernels()) {
+    for (int d = 0; d < kIndexDomains; ++d) {
+      const IndexDomain domain = IndexDomain(d);
+      const RenderParams params =
+          domain == IndexDomain::Log2
+              ? testParams<IndexDomain::Log2>(1.0f / 64, 65536.0f, lut)
+              : testParams<IndexDomain::Linear>(1.0f / 64, 65536.0f, lut);
+
+      qint64 best = std::numeric_limits<qint64>::max();
+      for (int run = 0; run < kRuns; ++run) {
+        QElapsedTimer clock;
+        clock.start();
+        for (int y = 0; y < kRows; ++y)
+          c.fn[d](src.data() + size_t(y) * kWidth, dst.data(), kWidth,
+                  params);
+        best = std::min(best, clock.nsecsElapsed());
+      }
+      qDebug() << "RenderKernels:" << c.name << indexDomainName(domain)
+               << double(best) / (double(kWidth) * kRows) << "ns/pixel";
+    }
+  }
+
+  // upscaling rows 1.5x, as when the output is larger than the read
+  constexpr int kSrcWidth = kWidth * 2 / 3;
+  std::vector<int> i0, i1;
+  std::vector<float> w;
+  testTaps(kSrcWidth, kWidth, i0, i1, w);
+  const ResampleTaps taps{i0.data(), i1.data(), w.data(), kWidth};
+  std::vector<float> blended(kSrcWidth), out(kWidth);
+  for (const KernelChoice &c : supportedKernels()) {
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int run = 0; run < kRuns; ++run) {
+      QElapsedTimer clock;
+      clock.start();
+      for (int y = 0; y < kRows; ++y) {
+        const float *r0 = src.data() + size_t(y) * kSrcWidth;
+        c.resample(r0, r0 + kSrcWidth, float(y % 7) / 7.0f, kSrcWidth, taps,
+                   blended.data(), out.data());
+      }
+      best = std::min(best, clock.nsecsElapsed());
+    }
+    qDebug() << "RenderKernels:" << c.name << "resample"
+             << double(best) / (double(kWidth) * kRows) << "ns/pixel";
+  }
+}
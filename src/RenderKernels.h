@@ -0,0 +1,161 @@
+// RenderKernels.h
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Per-frame constants for turning raw floats into LUT colours.
+ *
+ * lutIndex = clamp((indexValue(value) - min) * scale, 0, maxIndex), and any
+ * value <= 0 is background (opaque black).  min is on the kernel's index
+ * axis (see IndexDomain).  See ColormapLut for how the table is laid out.
+ */
+struct RenderParams {
+  float min = 0.0f;
+  float scale = 1.0f;
+  float maxIndex = 0.0f;
+  const uint32_t *lut = nullptr;
+};
+
+/// Colour for background (value <= 0) pixels.
+constexpr uint32_t kBackgroundPixel = 0xff000000u;
+
+/**
+ * @brief The axis the LUT is indexed along.
+ *
+ * Stretch curves are folded into the LUT, so most stretches share the
+ * Linear kernels.  A log stretch spans decades that a linear index cannot
+ * resolve near the lower bound; Log2 kernels index by the float's bit
+ * pattern instead, a piecewise-linear log2 (within 0.09 of an octave)
+ * that costs one int → float convert per pixel.
+ *
+ * Each kernel is instantiated per domain, so the choice is made once per
+ * frame by picking a function, never inside the pixel loop.
+ */
+enum class IndexDomain { Linear, Log2 };
+constexpr int kIndexDomains = 2;
+
+/// Name of @p domain (for logging).
+const char *indexDomainName(IndexDomain domain);
+
+// The inline helpers below are static: the SIMD kernels are compiled with
+// -msse4.2 / -mavx2 / -mavx512f, and a shared (weak) copy emitted there
+// could be the one the linker keeps for every caller, scalar path included.
+
+/// @p value on the index axis of @p D.
+template <IndexDomain D> static inline float indexValue(float value) {
+  if constexpr (D == IndexDomain::Log2) {
+    int32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return float(bits);
+  } else {
+    return value;
+  }
+}
+
+/// Render @p n floats from @p src into packed 0xffRRGGBB pixels at @p dst.
+using RenderRowFn = void (*)(const float *src, uint32_t *dst, int n,
+                             const RenderParams &params);
+
+/**
+ * @brief Reference per-pixel operation.
+ *
+ * Every vector variant must reproduce this bit for bit, so the comparisons
+ * are written to match SSE/AVX min/max semantics (a NaN index maps to 0).
+ */
+template <IndexDomain D = IndexDomain::Linear>
+static inline uint32_t renderPixel(float value, const RenderParams &params) {
+  if (value <= 0.0f)
+    return kBackgroundPixel;
+  float lutIndex = (indexValue<D>(value) - params.min) * params.scale;
+  lutIndex = lutIndex > 0.0f ? lutIndex : 0.0f;
+  lutIndex = lutIndex < params.maxIndex ? lutIndex : params.maxIndex;
+  return params.lut[int(lutIndex)];
+}
+
+/// Scalar reference kernel.
+template <IndexDomain D>
+void renderRowScalar(const float *src, uint32_t *dst, int n,
+                     const RenderParams &params);
+
+#ifdef SWIFT_GUI_X86_KERNELS
+// Compiled in their own translation units with -msse4.2 / -mavx2 /
+// -mavx512f; only call them after checking the CPU supports them.
+template <IndexDomain D>
+void renderRowSse42(const float *src, uint32_t *dst, int n,
+                    const RenderParams &params);
+template <IndexDomain D>
+void renderRowAvx2(const float *src, uint32_t *dst, int n,
+                   const RenderParams &params);
+template <IndexDomain D>
+void renderRowAvx512(const float *src, uint32_t *dst, int n,
+                     const RenderParams &params);
+#endif
+
+/**
+ * @brief Bilinear taps along an output row, see resampleRow kernels.
+ *
+ * Output i interpolates blended[i0[i]] and blended[i1[i]] with weight w[i]
+ * on the latter.
+ */
+struct ResampleTaps {
+  const int *i0 = nullptr;
+  const int *i1 = nullptr;
+  const float *w = nullptr;
+  int n = 0; ///< output samples
+};
+
+/**
+ * @brief One output row of a separable bilinear resample.
+ *
+ * Blends source rows @p r0 and @p r1 (@p n floats each, weight @p w on
+ * @p r1) into @p blended, then interpolates @p blended through @p taps
+ * into @p out.
+ */
+using ResampleRowFn = void (*)(const float *r0, const float *r1, float w,
+                               int n, const ResampleTaps &taps,
+                               float *blended, float *out);
+
+/// a + w * (b - a), rounded the same way by every resample kernel.
+static inline float lerpSample(float a, float b, float w) {
+  return a + w * (b - a);
+}
+
+/// Scalar reference resample kernel.
+void resampleRowScalar(const float *r0, const float *r1, float w, int n,
+                       const ResampleTaps &taps, float *blended, float *out);
+
+#ifdef SWIFT_GUI_X86_KERNELS
+void resampleRowSse42(const float *r0, const float *r1, float w, int n,
+                      const ResampleTaps &taps, float *blended, float *out);
+void resampleRowAvx2(const float *r0, const float *r1, float w, int n,
+                     const ResampleTaps &taps, float *blended, float *out);
+void resampleRowAvx512(const float *r0, const float *r1, float w, int n,
+                       const ResampleTaps &taps, float *blended, float *out);
+#endif
+
+/**
+ * @brief The fastest @p domain kernel this CPU supports, chosen once at
+ * runtime.
+ *
+ * Each candidate is checked against renderRowScalar() and
+ * resampleRowScalar() on synthetic data before it is used; an instruction
+ * set whose kernels disagree is skipped.
+ */
+RenderRowFn renderRowKernel(IndexDomain domain = IndexDomain::Linear);
+
+/// The resample kernel of the instruction set renderRowKernel() picked.
+ResampleRowFn resampleRowKernel();
+
+/// Name of the kernels returned by renderRowKernel() (for logging).
+const char *renderRowKernelName();
+
+/**
+ * @brief Microbenchmark of every kernel instantiation this CPU can run.
+ *
+ * Renders a synthetic 4096-pixel-wide frame with each instruction set and
+ * index domain, and resamples one by 1.5x, and logs ns per pixel (best of
+ * several runs).
+ */
+void benchmarkRenderKernels();
@@ -0,0 +1,75 @@
+// RenderKernels_avx2.cpp  (compiled with -mavx2)
+#include "RenderKernels.h"
+#include <immintrin.h>
+
+template <IndexDomain D>
+void renderRowAvx2(const float *src, uint32_t *dst, int n,
+                   const RenderParams &params) {
+  const __m256 min = _mm256_set1_ps(params.min);
+  const __m256 scale = _mm256_set1_ps(params.scale);
+  const __m256 maxIndex = _mm256_set1_ps(params.maxIndex);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256i background = _mm256_set1_epi32(int(kBackgroundPixel));
+  const int *lut = reinterpret_cast<const int *>(params.lut);
+
+  int x = 0;
+  for (; x + 8 <= n; x += 8) {
+    __m256 value = _mm256_loadu_ps(src + x);
+
+    // onto the index axis, resolved at compile time
+    __m256 index = value;
+    if constexpr (D == IndexDomain::Log2)
+      index = _mm256_cvtepi32_ps(_mm256_castps_si256(value));
+
+    // normalize + clamp; max/min operand order matches renderPixel()
+    __m256 lutIndex = _mm256_mul_ps(_mm256_sub_ps(index, min), scale);
+    lutIndex = _mm256_min_ps(_mm256_max_ps(lutIndex, zero), maxIndex);
+    __m256i idx = _mm256_cvttps_epi32(lutIndex);
+
+    __m256i rgb = _mm256_i32gather_epi32(lut, idx, 4);
+
+    __m256i isBackground =
+        _mm256_castps_si256(_mm256_cmp_ps(value, zero, _CMP_LE_OQ));
+    rgb = _mm256_blendv_epi8(rgb, background, isBackground);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), rgb);
+  }
+
+  for (; x < n; ++x)
+    dst[x] = renderPixel<D>(src[x], params);
+}
+
+template void renderRowAvx2<IndexDomain::Linear>(const float *, uint32_t *,
+                                                 int, const RenderParams &);
+template void renderRowAvx2<IndexDomain::Log2>(const float *, uint32_t *, int,
+                                               const RenderParams &);
+
+void resampleRowAvx2(const float *r0, const float *r1, float w, int n,
+                     const ResampleTaps &taps, float *blended, float *out) {
+  // blend the two source rows; sub, mul, add as in lerpSample()
+  const __m256 weight = _mm256_set1_ps(w);
+  int x = 0;
+  for (; x + 8 <= n; x += 8) {
+    __m256 a = _mm256_loadu_ps(r0 + x);
+    __m256 b = _mm256_loadu_ps(r1 + x);
+    __m256 delta = _mm256_mul_ps(weight, _mm256_sub_ps(b, a));
+    _mm256_storeu_ps(blended + x, _mm256_add_ps(a, delta));
+  }
+  for (; x < n; ++x)
+    blended[x] = lerpSample(r0[x], r1[x], w);
+
+  // interpolate along the row through the taps
+  int y = 0;
+  for (; y + 8 <= taps.n; y += 8) {
+    __m256i i0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(taps.i0 + y));
+    __m256i i1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(taps.i1 + y));
+    __m256 a = _mm256_i32gather_ps(blended, i0, 4);
+    __m256 b = _mm256_i32gather_ps(blended, i1, 4);
+    __m256 wy = _mm256_loadu_ps(taps.w + y);
+    _mm256_storeu_ps(out + y,
+                     _mm256_add_ps(a, _mm256_mul_ps(wy, _mm256_sub_ps(b, a))));
+  }
+  for (; y < taps.n; ++y)
+    out[y] = lerpSample(blended[taps.i0[y]], blended[taps.i1[y]], taps.w[y]);
+}
@@ -0,0 +1,75 @@
+// RenderKernels_avx512.cpp  (compiled with -mavx512f)
+#include "RenderKernels.h"
+#include <immintrin.h>
+
+template <IndexDomain D>
+void renderRowAvx512(const float *src, uint32_t *dst, int n,
+                     const RenderParams &params) {
+  const __m512 min = _mm512_set1_ps(params.min);
+  const __m512 scale = _mm512_set1_ps(params.scale);
+  const __m512 maxIndex = _mm512_set1_ps(params.maxIndex);
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512i background = _mm512_set1_epi32(int(kBackgroundPixel));
+  const int *lut = reinterpret_cast<const int *>(params.lut);
+
+  for (int x = 0; x < n; x += 16) {
+    // masked loads/stores handle the tail without a scalar loop
+    const int remaining = n - x;
+    const __mmask16 lanes =
+        remaining >= 16 ? __mmask16(0xffff) : __mmask16((1u << remaining) - 1);
+
+    __m512 value = _mm512_maskz_loadu_ps(lanes, src + x);
+
+    // onto the index axis, resolved at compile time
+    __m512 index = value;
+    if constexpr (D == IndexDomain::Log2)
+      index = _mm512_cvtepi32_ps(_mm512_castps_si512(value));
+
+    // normalize + clamp; max/min operand order matches renderPixel()
+    __m512 lutIndex = _mm512_mul_ps(_mm512_sub_ps(index, min), scale);
+    lutIndex = _mm512_min_ps(_mm512_max_ps(lutIndex, zero), maxIndex);
+    __m512i idx = _mm512_cvttps_epi32(lutIndex);
+
+    __m512i rgb = _mm512_mask_i32gather_epi32(background, lanes, idx, lut, 4);
+
+    __mmask16 isBackground = _mm512_cmp_ps_mask(value, zero, _CMP_LE_OQ);
+    rgb = _mm512_mask_mov_epi32(rgb, isBackground, background);
+    _mm512_mask_storeu_epi32(dst + x, lanes, rgb);
+  }
+}
+
+template void renderRowAvx512<IndexDomain::Linear>(const float *, uint32_t *,
+                                                   int, const RenderParams &);
+template void renderRowAvx512<IndexDomain::Log2>(const float *, uint32_t *,
+                                                 int, const RenderParams &);
+
+void resampleRowAvx512(const float *r0, const float *r1, float w, int n,
+                       const ResampleTaps &taps, float *blended, float *out) {
+  // blend the two source rows; sub, mul, add as in lerpSample()
+  const __m512 weight = _mm512_set1_ps(w);
+  for (int x = 0; x < n; x += 16) {
+    const int remaining = n - x;
+    const __mmask16 lanes =
+        remaining >= 16 ? __mmask16(0xffff) : __mmask16((1u << remaining) - 1);
+    __m512 a = _mm512_maskz_loadu_ps(lanes, r0 + x);
+    __m512 b = _mm512_maskz_loadu_ps(lanes, r1 + x);
+    _mm512_mask_storeu_ps(
+        blended + x, lanes,
+        _mm512_add_ps(a, _mm512_mul_ps(weight, _mm512_sub_ps(b, a))));
+  }
+
+  // interpolate along the row through the taps; masked gathers cost more
+  // than a scalar tail here
+  int y = 0;
+  for (; y + 16 <= taps.n; y += 16) {
+    __m512i i0 = _mm512_loadu_si512(taps.i0 + y);
+    __m512i i1 = _mm512_loadu_si512(taps.i1 + y);
+    __m512 a = _mm512_i32gather_ps(i0, blended, 4);
+    __m512 b = _mm512_i32gather_ps(i1, blended, 4);
+    __m512 wy = _mm512_loadu_ps(taps.w + y);
+    _mm512_storeu_ps(out + y,
+                     _mm512_add_ps(a, _mm512_mul_ps(wy, _mm512_sub_ps(b, a))));
+  }
+  for (; y < taps.n; ++y)
+    out[y] = lerpSample(blended[taps.i0[y]], blended[taps.i1[y]], taps.w[y]);
+}
@@ -0,0 +1,77 @@
+// RenderKernels_sse42.cpp  (compiled with -msse4.2)
+#include "RenderKernels.h"
+#include <smmintrin.h>
+
+template <IndexDomain D>
+void renderRowSse42(const float *src, uint32_t *dst, int n,
+                    const RenderParams &params) {
+  const __m128 min = _mm_set1_ps(params.min);
+  const __m128 scale = _mm_set1_ps(params.scale);
+  const __m128 maxIndex = _mm_set1_ps(params.maxIndex);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128i background = _mm_set1_epi32(int(kBackgroundPixel));
+  const uint32_t *lut = params.lut;
+
+  int x = 0;
+  for (; x + 4 <= n; x += 4) {
+    __m128 value = _mm_loadu_ps(src + x);
+
+    // onto the index axis, resolved at compile time
+    __m128 index = value;
+    if constexpr (D == IndexDomain::Log2)
+      index = _mm_cvtepi32_ps(_mm_castps_si128(value));
+
+    // normalize + clamp; max/min operand order matches renderPixel()
+    __m128 lutIndex = _mm_mul_ps(_mm_sub_ps(index, min), scale);
+    lutIndex = _mm_min_ps(_mm_max_ps(lutIndex, zero), maxIndex);
+    __m128i idx = _mm_cvttps_epi32(lutIndex);
+
+    // no gather before AVX2
+    __m128i rgb = _mm_setr_epi32(int(lut[_mm_cvtsi128_si32(idx)]),
+                                 int(lut[_mm_extract_epi32(idx, 1)]),
+                                 int(lut[_mm_extract_epi32(idx, 2)]),
+                                 int(lut[_mm_extract_epi32(idx, 3)]));
+
+    __m128i isBackground = _mm_castps_si128(_mm_cmple_ps(value, zero));
+    rgb = _mm_blendv_epi8(rgb, background, isBackground);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), rgb);
+  }
+
+  for (; x < n; ++x)
+    dst[x] = renderPixel<D>(src[x], params);
+}
+
+template void renderRowSse42<IndexDomain::Linear>(const float *, uint32_t *,
+                                                  int, const RenderParams &);
+template void renderRowSse42<IndexDomain::Log2>(const float *, uint32_t *,
+                                                int, const RenderParams &);
+
+void resampleRowSse42(const float *r0, const float *r1, float w, int n,
+                      const ResampleTaps &taps, float *blended, float *out) {
+  // blend the two source rows; sub, mul, add as in lerpSample()
+  const __m128 weight = _mm_set1_ps(w);
+  int x = 0;
+  for (; x + 4 <= n; x += 4) {
+    __m128 a = _mm_loadu_ps(r0 + x);
+    __m128 b = _mm_loadu_ps(r1 + x);
+    _mm_storeu_ps(blended + x,
+                  _mm_add_ps(a, _mm_mul_ps(weight, _mm_sub_ps(b, a))));
+  }
+  for (; x < n; ++x)
+    blended[x] = lerpSample(r0[x], r1[x], w);
+
+  // interpolate along the row; no gather before AVX2
+  int y = 0;
+  for (; y + 4 <= taps.n; y += 4) {
+    const int *i0 = taps.i0 + y;
+    const int *i1 = taps.i1 + y;
+    __m128 a = _mm_setr_ps(blended[i0[0]], blended[i0[1]], blended[i0[2]],
+                           blended[i0[3]]);
+    __m128 b = _mm_setr_ps(blended[i1[0]], blended[i1[1]], blended[i1[2]],
+                           blended[i1[3]]);
+    __m128 wy = _mm_loadu_ps(taps.w + y);
+    _mm_storeu_ps(out + y, _mm_add_ps(a, _mm_mul_ps(wy, _mm_sub_ps(b, a))));
+  }
+  for (; y < taps.n; ++y)
+    out[y] = lerpSample(blended[taps.i0[y]], blended[taps.i1[y]], taps.w[y]);
+}
@@ -1,29 +1,135 @@
 // RotationFrameLoader.cpp
 #include "RotationFrameLoader.h"
+#include "FramePackWriter.h"
+#include "Hdf5Lock.h"
+#include "NormalizationCache.h"
+#include "RenderKernels.h"
+#include "StageTimings.h"
 #include "VizTabWidget.h"
 #include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QSemaphore>
 #include <algorithm>
+#include <cmath>
 #include <limits>
 
+// Periodic pacing / cache report, off by default; enable it with
+// QT_LOGGING_RULES="swiftgui.loader.stats.debug=true"
+Q_LOGGING_CATEGORY(lcLoaderStats, "swiftgui.loader.stats", QtInfoMsg)
+
+// Don't preload while the knob is still moving through files
+static constexpr qint64 kPreloadSettleMs = 300;
+
+// Volume preloads read this much per H5Dread, releasing HDF5 in between
+static constexpr size_t kPreloadSlabBytes = size_t(32) * 1024 * 1024;
+
+// How far ahead (in frames) to ask the kernel for a mapped volume
+static constexpr int kMappedReadAhead = 4;
+
+// Height of one parallel render tile
+static constexpr int kRowsPerTile = 32;
+
+// Frames out of the pool besides the ring and the cache: the one being
+// rendered, the one on screen and one queued to the UI, plus slack
+static constexpr int kFramesInFlight = 4;
+
+// Decades below the upper bound a log stretch shows at most (the lower
+// percentile is often 0 in sparse fields)
+static constexpr float kLogStretchDecades = 6.0f;
+
 RotationFrameLoader::RotationFrameLoader(QObject *parent)
-    : QObject(parent), m_timer(new QTimer(this)) {
-  // Always-on rotation timer
+    : QObject(parent), m_renderRow{renderRowKernel(IndexDomain::Linear),
+                                   renderRowKernel(IndexDomain::Log2)},
+      m_resampleRow(resampleRowKernel()),
+      m_timer(new QTimer(this)) {
+  // Leave half the cores to SWIFT by default; see setRenderThreads()
+  m_renderThreads = std::max(1, QThread::idealThreadCount() / 2);
+  m_renderPool.setMaxThreadCount(std::max(1, m_renderThreads - 1));
+
+  // Cached frames come out of the frame pool's budget
+  sizeFramePool();
+  m_framePool->setReclaimer([this] { return m_frameCache.evictOldest(); });
+
+  // Normalization cache fills itself on a low-priority thread
+  m_normCache = new NormalizationCache;
+  m_normThread = new QThread(this);
+  m_normCache->moveToThread(m_normThread);
+  m_normThread->start(QThread::LowestPriority);
+
+  // The frame-pack transcoder gets a thread of its own, so a long
+  // transcode never holds up the (much cheaper) precompute
+  m_packWriter = new FramePackWriter(m_normCache);
+  m_packThread = new QThread(this);
+  m_packWriter->moveToThread(m_packThread);
+  m_packThread->start(QThread::LowestPriority);
+
+  // Percentiles of a new latest file are binned off the rotation clock
+  m_percentileThread = QThread::create([this] { percentileLoop(); });
+  m_percentileThread->start(QThread::LowPriority);
+
+  // ...and files we are about to switch to are opened off it
+  m_switchThread = QThread::create([this] { switchLoop(); });
+  m_switchThread->start();
+
+  // Rotation clock, re-armed for each frame's deadline; it only runs while
+  // somebody shows the frames (see setRenderDemand())
+  m_timer->setSingleShot(true);
+  m_timer->setTimerType(Qt::PreciseTimer);
   connect(m_timer, &QTimer::timeout, this,
           &RotationFrameLoader::nextRotationFrame);
-  m_timer->start(1000 / m_fps);
+  m_scheduler.start(m_fps);
 }
 
 RotationFrameLoader::~RotationFrameLoader() {
   m_timer->stop();
+
+  // release and join the prefetch stage before its handles go away
+  m_ring.stop();
+  {
+    QMutexLocker lock(&m_stateMutex);
+    m_stateChanged.wakeAll();
+  }
+  if (m_prefetchThread) {
+    m_prefetchThread->wait();
+    delete m_prefetchThread;
+  }
+
+  // abandon any percentile job and join its thread
+  ++m_percentileGeneration;
+  {
+    QMutexLocker lock(&m_percentileMutex);
+    m_percentileStop = true;
+    m_percentileWake.wakeAll();
+  }
+  m_percentileThread->wait();
+  delete m_percentileThread;
+
+  // same for the switch thread
+  ++m_switchGeneration;
+  {
+    QMutexLocker lock(&m_switchMutex);
+    m_switchStop = true;
+    m_switchWake.wakeAll();
+  }
+  m_switchThread->wait();
+  delete m_switchThread;
+
+  // finish the background transcode and precompute (saves the sidecar)
+  m_packThread->quit();
+  m_packThread->wait();
+  delete m_packWriter;
+  m_normThread->quit();
+  m_normThread->wait();
+  delete m_normCache;
+
   // tear down HDF5 in reverse order
+  QMutexLocker h5(&hdf5Mutex());
   if (m_memSpace >= 0)
     H5Sclose(m_memSpace);
-  if (m_fileSpace >= 0)
-    H5Sclose(m_fileSpace);
-  if (m_dsetId >= 0)
-    H5Dclose(m_dsetId);
-  if (m_fileId >= 0)
-    H5Fclose(m_fileId);
+  m_handles.clear();
+  m_stagingHandles.clear();
 }
 
 void RotationFrameLoader::startLoading(const QString &imageDirectory,
@@ -31,100 +137,507 @@ void RotationFrameLoader::startLoading(const QString &imageDirectory,
                                        const QString &datasetKey,
                                        int colormapIdx, int fps,
                                        bool keepPercentiles) {
-  // stash parameters
-  m_imageDirectory = imageDirectory;
-  m_currentFileNumber = fileNumber;
-  m_currentDatasetKey = datasetKey;
-  m_fps = fps;
-  m_colormapIdx = colormapIdx;
-  setColormap(colormapIdx);
-
-  // close previous HDF5 handles
-  if (m_memSpace >= 0) {
-    H5Sclose(m_memSpace);
-    m_memSpace = -1;
+  LoadRequest request{imageDirectory, fileNumber, datasetKey,
+                      colormapIdx,    fps,        keepPercentiles};
+  if (queueSwitch(request))
+    return;
+
+  // loading right here; forget any switch still being prepared
+  ++m_switchGeneration;
+  m_loadPending = false;
+  loadFile(request);
+}
+
+/**
+ * @brief Parks @p request behind a background open if that saves a stall.
+ *
+ * Only while a file is rotating on screen and @p request moves to another
+ * one that would need an H5Fopen: frame packs are just a mapping away and
+ * pooled (or pre-warmed) files are open already, so those load at once.
+ * While paused nothing would ever prime the switch, so it loads directly.
+ * @return true if the load now waits for the switch thread.
+ */
+bool RotationFrameLoader::queueSwitch(const LoadRequest &request) {
+  QMutexLocker lock(&m_stateMutex);
+  if (!m_demanded || m_nFrames <= 0 ||
+      request.imageDirectory != m_imageDirectory ||
+      request.fileNumber == m_currentFileNumber)
+    return false;
+
+  const QString path = request.imageDirectory +
+                       QString("image_%1.hdf5").arg(request.fileNumber);
+  if (m_framePacks && QFileInfo::exists(FramePack::packPath(path)))
+    return false;
+  {
+    QMutexLocker h5(&hdf5Mutex());
+    if (m_handles.contains(path) || m_stagingHandles.contains(path))
+      return false;
+  }
+
+  std::unique_ptr<SwitchJob> job = switchJob(path, request.datasetKey);
+  job->generation = ++m_switchGeneration;
+  m_pendingLoad = request;
+  m_loadPending = true;
+
+  QMutexLocker jobs(&m_switchMutex);
+  m_switchJob = std::move(job);
+  m_switchWake.wakeOne();
+  return true;
+}
+
+/**
+ * @brief A job opening @p path for @p datasetKey and the split-view panels.
+ *
+ * Caller must hold m_stateMutex.
+ */
+std::unique_ptr<RotationFrameLoader::SwitchJob>
+RotationFrameLoader::switchJob(const QString &path,
+                               const QString &datasetKey) const {
+  auto job = std::make_unique<SwitchJob>();
+  job->path = path;
+  job->datasets << datasetKey;
+  for (const Panel &panel : m_panels) {
+    if (panel.key != datasetKey)
+      job->datasets << panel.key;
   }
-  if (m_fileSpace >= 0) {
-    H5Sclose(m_fileSpace);
-    m_fileSpace = -1;
+  job->firstFrame = m_currentRotationFrame + 1;
+  return job;
+}
+
+void RotationFrameLoader::prewarmFile(int fileNumber) {
+  QMutexLocker lock(&m_stateMutex);
+  if (m_imageDirectory.isEmpty() || fileNumber == m_currentFileNumber)
+    return;
+
+  const QString path =
+      m_imageDirectory + QString("image_%1.hdf5").arg(fileNumber);
+  {
+    QMutexLocker h5(&hdf5Mutex());
+    if (m_handles.contains(path) || m_stagingHandles.contains(path))
+      return;
   }
-  if (m_dsetId >= 0) {
-    H5Dclose(m_dsetId);
-    m_dsetId = -1;
+
+  std::unique_ptr<SwitchJob> job = switchJob(path, m_currentDatasetKey);
+  QMutexLocker jobs(&m_switchMutex);
+  m_prewarmJob = std::move(job);
+  m_switchWake.wakeOne();
+}
+
+/**
+ * @brief Switch thread: runs the queued switch, else the queued pre-warm.
+ */
+void RotationFrameLoader::switchLoop() {
+  QMutexLocker lock(&m_switchMutex);
+  while (!m_switchStop) {
+    std::unique_ptr<SwitchJob> job =
+        std::move(m_switchJob ? m_switchJob : m_prewarmJob);
+    if (!job) {
+      m_switchWake.wait(&m_switchMutex);
+      continue;
+    }
+    lock.unlock();
+    primeFile(*job);
+    lock.relock();
+    if (job->generation > 0)
+      m_switchPrimed.store(job->generation);
   }
-  if (m_fileId >= 0) {
-    H5Fclose(m_fileId);
-    m_fileId = -1;
+}
+
+/**
+ * @brief Opens @p job's file and datasets into m_stagingHandles.
+ *
+ * Then reads the next kPrimeFrames slices of the first dataset, which
+ * fills that dataset's chunk cache (it moves into m_handles with the
+ * handles) and the page cache for mapped reads.  hdf5Mutex() is only held
+ * per step, so the current file keeps rendering in between.  A failed
+ * open is left for the load to report.
+ */
+void RotationFrameLoader::primeFile(const SwitchJob &job) {
+  auto superseded = [&] {
+    return job.generation > 0 && job.generation != m_switchGeneration.load();
+  };
+
+  hsize_t dims[3] = {0, 0, 0};
+  {
+    QMutexLocker h5(&hdf5Mutex());
+    Hdf5FileHandles *file = m_stagingHandles.acquire(job.path);
+    if (!file)
+      return;
+    for (const QString &key : job.datasets) {
+      const Hdf5DatasetHandles &dataset = m_stagingHandles.dataset(*file, key);
+      if (key == job.datasets.front())
+        std::copy(dataset.dims, dataset.dims + 3, dims);
+    }
+  }
+  if (dims[0] == 0)
+    return;
+
+  std::vector<float> buf(size_t(dims[1]) * dims[2]);
+  for (int i = 0; i < kPrimeFrames && !superseded(); ++i) {
+    QMutexLocker h5(&hdf5Mutex());
+    // the loader may have taken the bundle already
+    if (!m_stagingHandles.contains(job.path))
+      return;
+    Hdf5FileHandles *file = m_stagingHandles.acquire(job.path);
+    const Hdf5DatasetHandles &dataset =
+        m_stagingHandles.dataset(*file, job.datasets.front());
+    hsize_t offset[3] = {hsize_t(job.firstFrame + i) % dims[0], 0, 0};
+    hsize_t count[3] = {1, dims[1], dims[2]};
+    hid_t memSpace = H5Screate_simple(3, count, nullptr);
+    H5Sselect_hyperslab(dataset.fileSpace, H5S_SELECT_SET, offset, nullptr,
+                        count, nullptr);
+    H5Dread(dataset.dsetId, H5T_NATIVE_FLOAT, memSpace, dataset.fileSpace,
+            H5P_DEFAULT, buf.data());
+    H5Sclose(memSpace);
   }
+}
+
+/**
+ * @brief Opens @p request's file and dataset and restarts rotation on it.
+ */
+void RotationFrameLoader::loadFile(const LoadRequest &request) {
+  // the prefetch thread renders from the same handles; hold it off
+  QMutexLocker lock(&m_stateMutex);
+  ++m_loadGeneration; // a preload still reading is for the old file
+
+  // stash parameters
+  m_imageDirectory = request.imageDirectory;
+  m_currentFileNumber = request.fileNumber;
+  m_currentDatasetKey = request.datasetKey;
+  m_fps = request.fps;
+  if (m_fps != m_scheduler.nominalFps())
+    m_scheduler.start(m_fps);
+  m_colormapIdx = request.colormapIdx;
+  setColormap(m_colormapIdx);
+  setImageDirectory(m_imageDirectory);
+
+  // file + dataset handles come from the pool; only the memspace is ours
+  m_fileId = m_dsetId = m_fileSpace = -1;
+  m_nFrames = 0;
 
-  // Open file with a larger chunk/cache (32 MiB) for better throughput
-  hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
-  H5Pset_cache(fapl,
-               /*mdc_nelmts=*/0,    // 0 = default # of metadata entries
-               /*rdcc_nslots=*/521, // raw-data chunk cache slots
-               /*rdcc_nbytes=*/32 * 1024 * 1024, // 32 MiB chunk cache
-               /*rdcc_w0=*/0.75);                // preemption policy
   QString path =
       m_imageDirectory + QString("image_%1.hdf5").arg(m_currentFileNumber);
-  m_fileId = H5Fopen(path.toUtf8().constData(), H5F_ACC_RDONLY, fapl);
-  H5Pclose(fapl);
-
-  // open dataset + get its dataspace
-  m_dsetId =
-      H5Dopen2(m_fileId, m_currentDatasetKey.toUtf8().constData(), H5P_DEFAULT);
-  m_fileSpace = H5Dget_space(m_dsetId);
-
-  // Read the step and age attributes from the root group
-  hid_t rootGroup = H5Gopen2(m_fileId, "/", H5P_DEFAULT);
-  if (rootGroup >= 0) {
-    // Unused currently!
-    // hid_t stepAttr = H5Aopen_name(rootGroup, "step");
-    // if (stepAttr >= 0) {
-    //   H5Aread(stepAttr, H5T_NATIVE_INT, &m_currentStep);
-    //   H5Aclose(stepAttr);
-    // } else {
-    //   qWarning() << "Failed to read 'step' attribute.";
-    // }
-
-    hid_t ageAttr = H5Aopen_name(rootGroup, "age");
-    if (ageAttr >= 0) {
-      H5Aread(ageAttr, H5T_NATIVE_DOUBLE, &m_currentAge);
-      H5Aclose(ageAttr);
-      emit ageChanged(static_cast<long long>(m_currentAge * 1e9));
-
-      // Emit percent clamped to [0, 100]
-      int intPercent = static_cast<int>(m_currentAge / 13.81 * 100);
-      emit percentChanged(std::clamp(intPercent, 0, 100));
-    } else {
+
+  // a current frame pack stands in for the HDF5 file entirely
+  m_packed = nullptr;
+  if (m_framePacks && m_pack.open(path))
+    m_packed = m_pack.dataset(m_currentDatasetKey);
+  if (!m_packed && m_panels.empty())
+    m_pack.close();
+
+  QMutexLocker h5(&hdf5Mutex());
+  Hdf5FileHandles *file = nullptr;
+  haddr_t rawOffset = HADDR_UNDEF;
+  m_decoder.detach();
+  if (m_packed) {
+    if (m_pack.hasAge())
+      setAge(m_pack.age());
+    m_nFrames = m_packed->frames;
+    m_fullXres = m_packed->xres;
+    m_fullYres = m_packed->yres;
+  } else {
+    // opened (and primed) in the background by a switch or a pre-warm
+    Hdf5FileHandles staged;
+    if (m_stagingHandles.take(path, staged))
+      m_handles.adopt(std::move(staged));
+
+    file = m_handles.acquire(path);
+    if (!file) {
+      qWarning() << "RotationFrameLoader: cannot open" << path;
+      h5.unlock();
+      invalidatePrefetch();
+      return;
+    }
+    const Hdf5DatasetHandles &dataset =
+        m_handles.dataset(*file, m_currentDatasetKey);
+    m_fileId = file->fileId;
+    m_dsetId = dataset.dsetId;
+    m_fileSpace = dataset.fileSpace;
+
+    // The age attribute is read once, when the pool opens the file
+    if (file->hasAge)
+      setAge(file->age);
+    else
       qWarning() << "Failed to read 'age' attribute.";
+
+    if (m_dsetId < 0) {
+      qWarning() << "RotationFrameLoader: no" << m_currentDatasetKey
+                 << "dataset in" << path;
+      h5.unlock();
+      invalidatePrefetch();
+      return;
     }
 
-    H5Gclose(rootGroup);
-  } else {
-    qWarning() << "Failed to open root group.";
+    // full dims [frames, x, y]
+    const hsize_t *fullDims = dataset.dims;
+    m_nFrames = int(fullDims[0]);
+    m_fullXres = int(fullDims[1]);
+    m_fullYres = int(fullDims[2]);
+    rawOffset = dataset.rawOffset;
+
+    // filtered chunks: decode in parallel ourselves where we can
+    if (m_parallelDecode && m_decoder.attach(m_dsetId, fullDims) &&
+        m_decoder.pipeline() != m_lastPipeline) {
+      m_lastPipeline = m_decoder.pipeline();
+      qDebug() << "RotationFrameLoader: decoding" << m_lastPipeline
+               << "chunks on" << m_renderThreads << "threads.";
+    }
   }
 
-  // query full dims [frames, x, y]
-  hsize_t fullDims[3];
-  H5Sget_simple_extent_dims(m_fileSpace, fullDims, nullptr);
-  m_nFrames = int(fullDims[0]);
-  m_xres = int(fullDims[1]);
-  m_yres = int(fullDims[2]);
+  // the other split-view datasets come from the same file
+  openPanels(path, file);
 
-  // create one‐slice memspace
-  hsize_t count[3] = {1, fullDims[1], fullDims[2]};
-  m_memSpace = H5Screate_simple(3, count, nullptr);
+  // output dims, memspace and reusable buffers for the current widget size
+  planDecimation();
+  h5.unlock();
 
-  // allocate reusable buffers
-  m_buf.assign(size_t(m_xres) * m_yres, 0.0f);
-  m_img = QImage(m_xres, m_yres, QImage::Format_RGB888);
+  // drop the previous volume; contiguous floats are mapped straight from the
+  // page cache, anything else is preloaded later if it is small enough (a
+  // pack is mapped already)
+  m_volume.release();
+  m_mapped.unmap();
+  qint64 volumeBytes =
+      qint64(m_nFrames) * m_fullXres * m_fullYres * sizeof(float);
+  if (m_mappedReads && rawOffset != HADDR_UNDEF && volumeBytes > 0)
+    m_mapped.map(path, size_t(rawOffset), size_t(volumeBytes));
+  m_preloadPending = !m_packed && m_mapped.isNull() &&
+                     m_preloadLimitBytes > 0 && volumeBytes > 0 &&
+                     volumeBytes <= m_preloadLimitBytes;
+  m_loadClock.start();
+
+  // hidden before there was anything to rotate: renders are avoided from
+  // the first file on
+  if (!m_demanded && !m_pauseClock.isValid())
+    m_pauseClock.start();
 
   // percentile compute
-  if (!keepPercentiles)
+  if (!request.keepPercentiles)
     computePercentiles();
+
+  // anything already rendered ahead belongs to the old file
+  invalidatePrefetch();
+  lock.unlock();
+  startPrefetch();
+}
+
+/**
+ * @brief Points the split-view panels at their datasets in @p path.
+ *
+ * Packed datasets decode from the pack already mapped for the file, the
+ * rest borrow handles from the pool; @p file is the pool entry if the
+ * current dataset already acquired it.  A dataset that is missing or not
+ * shaped like the current one is drawn black.  Caller must hold
+ * m_stateMutex and hdf5Mutex().
+ */
+void RotationFrameLoader::openPanels(const QString &path,
+                                     Hdf5FileHandles *file) {
+  for (Panel &panel : m_panels) {
+    panel.packed = m_pack.isOpen() ? m_pack.dataset(panel.key) : nullptr;
+    panel.dsetId = panel.fileSpace = -1;
+
+    int frames = 0, xres = 0, yres = 0;
+    if (panel.packed) {
+      frames = panel.packed->frames;
+      xres = panel.packed->xres;
+      yres = panel.packed->yres;
+    } else {
+      if (!file)
+        file = m_handles.acquire(path);
+      if (file) {
+        const Hdf5DatasetHandles &dataset = m_handles.dataset(*file, panel.key);
+        panel.dsetId = dataset.dsetId;
+        panel.fileSpace = dataset.fileSpace;
+        if (panel.dsetId >= 0) {
+          frames = int(dataset.dims[0]);
+          xres = int(dataset.dims[1]);
+          yres = int(dataset.dims[2]);
+        }
+      }
+    }
+
+    if (frames != m_nFrames || xres != m_fullXres || yres != m_fullYres) {
+      qWarning() << "RotationFrameLoader: no" << panel.key << "dataset shaped"
+                 << "like" << m_currentDatasetKey << "in" << path;
+      panel.packed = nullptr;
+      panel.dsetId = panel.fileSpace = -1;
+    }
+  }
+}
+
+void RotationFrameLoader::setSplitView(const QStringList &datasets,
+                                       const QList<int> &colormaps,
+                                       int columns) {
+  {
+    QMutexLocker lock(&m_stateMutex);
+    m_panels.clear();
+    m_panels.resize(size_t(datasets.size()));
+    for (qsizetype i = 0; i < datasets.size(); ++i) {
+      Panel &panel = m_panels[size_t(i)];
+      panel.key = datasets[i];
+      panel.colormapIdx = i < colormaps.size() ? colormaps[i] : m_colormapIdx;
+      const uint8_t (*cmap)[3] = nullptr;
+      size_t cmapSize = 0;
+      colormapTable(panel.colormapIdx, cmap, cmapSize);
+      panel.lut.update(cmap, cmapSize, stretchFor(panel.key), m_lutEntries);
+    }
+    m_splitColumns = std::clamp(columns, 1, std::max(int(m_panels.size()), 1));
+    if (m_currentFileNumber < 0)
+      return;
+  }
+
+  // reopen for the new layout: panel handles, cell size and read-ahead
+  jumpToFile(m_currentFileNumber, true);
+}
+
+/**
+ * @brief Number of split-view grid rows (1 when not split).
+ */
+int RotationFrameLoader::splitRows() const {
+  return m_panels.empty()
+             ? 1
+             : (int(m_panels.size()) + m_splitColumns - 1) / m_splitColumns;
+}
+
+/**
+ * @brief Publishes the current file's age and the matching progress.
+ */
+void RotationFrameLoader::setAge(double age) {
+  m_currentAge = age;
+  emit ageChanged(static_cast<long long>(m_currentAge * 1e9));
+
+  // Emit percent clamped to [0, 100]
+  int intPercent = static_cast<int>(m_currentAge / 13.81 * 100);
+  emit percentChanged(std::clamp(intPercent, 0, 100));
+}
+
+void RotationFrameLoader::setPreloadLimit(qint64 bytes) {
+  QMutexLocker lock(&m_stateMutex);
+  m_preloadLimitBytes = std::max<qint64>(bytes, 0);
+}
+
+void RotationFrameLoader::setPageBufferSize(qint64 bytes) {
+  QMutexLocker lock(&m_stateMutex);
+  QMutexLocker h5(&hdf5Mutex());
+  m_handles.setPageBufferSize(bytes);
+  m_stagingHandles.setPageBufferSize(bytes);
+
+  // the current handles were just closed; reopen through the pool
+  if (m_fileId >= 0) {
+    m_fileId = m_dsetId = m_fileSpace = -1;
+    m_nFrames = 0;
+    h5.unlock();
+    lock.unlock();
+    jumpToFile(m_currentFileNumber, true);
+  }
+}
+
+void RotationFrameLoader::setParallelDecode(bool enabled) {
+  QMutexLocker lock(&m_stateMutex);
+  m_parallelDecode = enabled;
+}
+
+void RotationFrameLoader::setFramePacks(bool enabled) {
+  m_framePacks = enabled;
+}
+
+void RotationFrameLoader::setMappedReads(bool enabled) {
+  QMutexLocker lock(&m_stateMutex);
+  m_mappedReads = enabled;
+}
+
+void RotationFrameLoader::setHandlePoolSize(int files) {
+  QMutexLocker lock(&m_stateMutex);
+  QMutexLocker h5(&hdf5Mutex());
+  m_handles.setCapacity(files);
+}
+
+void RotationFrameLoader::setReadAheadDepth(int depth) {
+  QMutexLocker lock(&m_stateMutex);
+  m_ring.setCapacity(depth);
+  sizeFramePool();
+  invalidatePrefetch();
+}
+
+/**
+ * @brief Drops everything in the read-ahead ring and restarts prefetching
+ * from the frame after the current one.  Caller must hold m_stateMutex.
+ */
+void RotationFrameLoader::invalidatePrefetch() {
+  ++m_generation;
+  m_prefetchCursor = m_nFrames > 0 ? (m_currentRotationFrame + 1) % m_nFrames
+                                   : 0;
+  m_ring.reset(m_generation);
+  m_stateChanged.wakeAll();
+}
+
+void RotationFrameLoader::startPrefetch() {
+  if (m_prefetchThread)
+    return;
+  m_prefetchThread = QThread::create([this] { prefetchLoop(); });
+  m_prefetchThread->start();
+}
+
+/**
+ * @brief Body of the prefetch thread.
+ *
+ * Reads and colormaps frames ahead of the rotation clock and pushes them
+ * into the ring, blocking while the ring is full.  Frames rendered for an
+ * old generation are rejected by the ring and simply dropped.
+ */
+void RotationFrameLoader::prefetchLoop() {
+  std::vector<float> buf;
+  while (!m_ring.isStopped()) {
+    RingFrame frame;
+    {
+      QMutexLocker lock(&m_stateMutex);
+      while (!m_ring.isStopped() && m_nFrames <= 0)
+        m_stateChanged.wait(&m_stateMutex);
+      if (m_ring.isStopped())
+        return;
+
+      // read the whole volume without the lock, so the ring keeps filling
+      // (and the clock fed) meanwhile
+      if (m_preloadPending && m_loadClock.elapsed() >= kPreloadSettleMs) {
+        m_preloadPending = false;
+        VolumeRead read;
+        read.dsetId = m_dsetId;
+        read.loadGeneration = m_loadGeneration.load();
+        read.fileNumber = m_currentFileNumber;
+        read.datasetKey = m_currentDatasetKey;
+        read.frames = m_nFrames;
+        read.xres = m_fullXres;
+        read.yres = m_fullYres;
+        {
+          // the pool may close its handle while we read
+          QMutexLocker h5(&hdf5Mutex());
+          H5Iinc_ref(read.dsetId);
+        }
+        lock.unlock();
+        preloadVolume(read);
+        continue;
+      }
+
+      frame.generation = m_generation;
+      frame.fileNumber = m_currentFileNumber;
+      frame.frameIndex = m_prefetchCursor;
+      m_prefetchCursor = (m_prefetchCursor + 1) % m_nFrames;
+
+      FrameKey key = frameKey(frame.frameIndex);
+      if (!m_frameCache.find(key, frame.image)) {
+        renderFrame(frame.frameIndex, buf, frame.image);
+        m_frameCache.insert(key, frame.image);
+      }
+    }
+    m_ring.push(std::move(frame));
+  }
 }
 
 void RotationFrameLoader::jumpToFile(int fileNumber, bool keepPercentiles) {
+  if (m_scrubbing) {
+    m_jumpClock.start();
+    m_awaitFirstPixels = true;
+  }
+
   // under the same rotation clock, just reopen
   startLoading(m_imageDirectory, fileNumber, m_currentDatasetKey, m_colormapIdx,
                m_fps, keepPercentiles);
@@ -134,307 +647,1195 @@ void RotationFrameLoader::jumpToFile(int fileNumber, bool keepPercentiles) {
  * @brief Computes the lower and upper percentiles for the current latest file.
  *
  * The minimum and maximum values computed here will be used to normalize all
- * preceding frames and get updates when there is a new file.
+ * preceding frames and get updates when there is a new file.  Each dataset's
+ * first slice is binned once into its PercentileEngine, so later percentile
+ * edits are answered from the histogram without touching the file.
+ *
+ * Cached bounds apply at once, unless exact percentiles are asked for: the
+ * cache holds histogram estimates only.  The rest are binned by the
+ * percentile thread while the current bounds stay in use; only when there
+ * is nothing to show meanwhile (the very first file) is the slice binned
+ * right here.
  */
 void RotationFrameLoader::computePercentiles() {
-  if (m_dsetId < 0 || m_nFrames <= 0)
+  if (m_nFrames <= 0)
     return;
 
   // Open the latest file, we always scale the latest file
   QString path =
       m_imageDirectory + QString("image_%1.hdf5").arg(m_latestFileNumber);
-  hid_t fileId =
-      H5Fopen(path.toUtf8().constData(), H5F_ACC_RDONLY, H5P_DEFAULT);
-
-  // First do the dark matter dataset
-
-  // Open the dark matter dataset
-  hid_t dsetId = H5Dopen2(fileId, "dark_matter", H5P_DEFAULT);
-  hid_t fileSpace = H5Dget_space(m_dsetId);
-  hsize_t fullDims[3];
-  H5Sget_simple_extent_dims(fileSpace, fullDims, nullptr);
-  hsize_t count[3] = {1, fullDims[1], fullDims[2]};
-  hid_t memSpace = H5Screate_simple(3, count, nullptr);
-
-  // Allocate buffer for reading
-  std::vector<float> buf(size_t(m_xres) * m_yres, 0.0f);
-
-  // read slice 0
-  hsize_t offset[3] = {0, 0, 0};
-  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr,
-                      (hsize_t[]){1, (hsize_t)m_xres, (hsize_t)m_yres},
-                      nullptr);
-  H5Dread(dsetId, H5T_NATIVE_FLOAT, memSpace, fileSpace, H5P_DEFAULT,
-          buf.data());
-  size_t N = m_buf.size();
-  if (N == 0) {
-    m_lowerValueDM = 0;
-    m_upperValueDM = 1;
-    return;
-  }
-  size_t lo = size_t((m_percentileLowDM / 100.f) * (N - 1) + .5f);
-  size_t hi = size_t((m_percentileHighDM / 100.f) * (N - 1) + .5f);
-  lo = std::clamp(lo, size_t(0), N - 1);
-  hi = std::clamp(hi, size_t(0), N - 1);
-  std::nth_element(buf.begin(), buf.begin() + lo, buf.end());
-  m_lowerValueDM = buf[lo];
-  std::nth_element(buf.begin(), buf.begin() + hi, buf.end());
-  m_upperValueDM = buf[hi];
 
-  // If these are the same, fall back to min/max
-  if (m_lowerValueDM == m_upperValueDM) {
-    m_lowerValueDM = std::numeric_limits<float>::max();
-    m_upperValueDM = std::numeric_limits<float>::lowest();
-    for (float v : buf) {
-      m_lowerValueDM = std::min(m_lowerValueDM, v);
-      m_upperValueDM = std::max(m_upperValueDM, v);
+  // Anything the background job (or a previous run) already worked out
+  auto job = std::make_unique<PercentileJob>();
+  bool haveBounds = true;
+  for (DatasetNormalization &norm : m_norm) {
+    bool cached =
+        !m_exactPercentiles &&
+        m_normCache->lookup(m_latestFileNumber, path, norm.key,
+                            norm.percentileLow, norm.percentileHigh,
+                            norm.lowerValue, norm.upperValue);
+    norm.cached = cached;
+    if (cached) {
+      norm.histogram.clear();
+      norm.hasBounds = true;
+      continue;
     }
+    job->datasets.push_back({norm.key, norm.percentileLow,
+                             norm.percentileHigh, PercentileEngine()});
+    haveBounds &= norm.hasBounds;
   }
 
-  // Now do the gas dataset
+  // Whatever is still in flight is for an older request
+  job->generation = ++m_percentileGeneration;
+  if (job->datasets.empty())
+    return;
+  job->fileNumber = m_latestFileNumber;
+  job->path = path;
+  job->exact = m_exactPercentiles;
 
-  dsetId = H5Dopen2(fileId, "gas", H5P_DEFAULT);
-  fileSpace = H5Dget_space(dsetId);
-  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr,
-                      (hsize_t[]){1, (hsize_t)m_xres, (hsize_t)m_yres},
-                      nullptr);
-  H5Dread(dsetId, H5T_NATIVE_FLOAT, memSpace, fileSpace, H5P_DEFAULT,
-          buf.data());
-  N = m_buf.size();
-  if (N == 0) {
-    m_lowerValueGas = 0;
-    m_upperValueGas = 1;
+  if (!haveBounds) {
+    if (binPercentiles(*job, &m_renderPool, m_renderThreads))
+      applyBinnedPercentiles(*job);
     return;
   }
-  lo = size_t((m_percentileLowGas / 100.f) * (N - 1) + .5f);
-  hi = size_t((m_percentileHighGas / 100.f) * (N - 1) + .5f);
-  lo = std::clamp(lo, size_t(0), N - 1);
-  hi = std::clamp(hi, size_t(0), N - 1);
-  std::nth_element(buf.begin(), buf.begin() + lo, buf.end());
-  m_lowerValueGas = buf[lo];
-  std::nth_element(buf.begin(), buf.begin() + hi, buf.end());
-  m_upperValueGas = buf[hi];
 
-  // If these are the same, fall back to min/max
-  if (m_lowerValueGas == m_upperValueGas) {
-    m_lowerValueGas = std::numeric_limits<float>::max();
-    m_upperValueGas = std::numeric_limits<float>::lowest();
-    for (float v : buf) {
-      m_lowerValueGas = std::min(m_lowerValueGas, v);
-      m_upperValueGas = std::max(m_upperValueGas, v);
+  QMutexLocker jobs(&m_percentileMutex);
+  m_percentileJob = std::move(job);
+  m_percentileWake.wakeOne();
+}
+
+/**
+ * @brief Reads slice 0 of every dataset of @p job and bins it.
+ *
+ * Opens the file itself rather than going through m_handles, so it needs
+ * no m_stateMutex and can run on the percentile thread.  Bounds for the
+ * job's percentile pairs go into m_normCache as they are found.  Gives up
+ * (returns false) if the file cannot be opened or a newer job superseded
+ * this one.
+ */
+bool RotationFrameLoader::binPercentiles(PercentileJob &job,
+                                         QThreadPool *pool, int threads) {
+  StageTimer timer(StageTimings::Normalize);
+
+  hid_t fileId;
+  {
+    QMutexLocker h5(&hdf5Mutex());
+    fileId = H5Fopen(job.path.toUtf8().constData(), H5F_ACC_RDONLY,
+                     H5P_DEFAULT);
+  }
+  if (fileId < 0) {
+    qWarning() << "RotationFrameLoader: cannot open" << job.path
+               << "for percentiles.";
+    return false;
+  }
+
+  std::vector<float> buf;
+  bool complete = true;
+  for (PercentileJob::Dataset &dataset : job.datasets) {
+    if (job.generation != m_percentileGeneration.load()) {
+      complete = false;
+      break;
+    }
+
+    // read slice 0
+    herr_t status = -1;
+    {
+      QMutexLocker h5(&hdf5Mutex());
+      hid_t dsetId = H5Dopen2(fileId, dataset.key.toUtf8().constData(),
+                              H5P_DEFAULT);
+      if (dsetId >= 0) {
+        hid_t fileSpace = H5Dget_space(dsetId);
+        hsize_t fullDims[3];
+        H5Sget_simple_extent_dims(fileSpace, fullDims, nullptr);
+        hsize_t offset[3] = {0, 0, 0};
+        hsize_t count[3] = {1, fullDims[1], fullDims[2]};
+        hid_t memSpace = H5Screate_simple(3, count, nullptr);
+        H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr,
+                            count, nullptr);
+        buf.resize(size_t(fullDims[1]) * fullDims[2]);
+        status = H5Dread(dsetId, H5T_NATIVE_FLOAT, memSpace, fileSpace,
+                         H5P_DEFAULT, buf.data());
+        H5Sclose(memSpace);
+        H5Sclose(fileSpace);
+        H5Dclose(dsetId);
+      }
+    }
+    if (status < 0) {
+      qWarning() << "RotationFrameLoader: no" << dataset.key << "dataset in"
+                 << job.path;
+      continue; // an empty histogram falls back to 0..1
     }
+
+    // bin without holding HDF5
+    dataset.histogram.build(buf.data(), buf.size(), pool, threads, job.exact);
+    std::vector<float> values = dataset.histogram.percentiles(
+        {dataset.percentileLow, dataset.percentileHigh});
+    if (values[0] == values[1])
+      values = {dataset.histogram.minValue(), dataset.histogram.maxValue()};
+    if (!job.exact)
+      m_normCache->insert(job.fileNumber, job.path, dataset.key,
+                          dataset.percentileLow, dataset.percentileHigh,
+                          values[0], values[1]);
   }
 
-  // Now do the stars dataset
-  dsetId = H5Dopen2(fileId, "stars", H5P_DEFAULT);
-  fileSpace = H5Dget_space(dsetId);
-  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr,
-                      (hsize_t[]){1, (hsize_t)m_xres, (hsize_t)m_yres},
-                      nullptr);
-  H5Dread(dsetId, H5T_NATIVE_FLOAT, memSpace, fileSpace, H5P_DEFAULT,
-          buf.data());
-  N = m_buf.size();
-  if (N == 0) {
-    m_lowerValueStars = 0;
-    m_upperValueStars = 1;
-    return;
+  QMutexLocker h5(&hdf5Mutex());
+  H5Fclose(fileId);
+  return complete;
+}
+
+/**
+ * @brief Installs the histograms of a finished job.
+ *
+ * Bounds are read off them for the percentile pairs set now, which may
+ * have been edited while the job ran.  Caller must hold m_stateMutex.
+ */
+void RotationFrameLoader::applyBinnedPercentiles(PercentileJob &job) {
+  for (PercentileJob::Dataset &dataset : job.datasets) {
+    DatasetNormalization *norm = normalization(dataset.key);
+    if (!norm)
+      continue;
+    norm->histogram = std::move(dataset.histogram);
+    norm->cached = false;
+    norm->hasBounds = true;
+    applyPercentiles(*norm);
   }
-  lo = size_t((m_percentileLowStars / 100.f) * (N - 1) + .5f);
-  hi = size_t((m_percentileHighStars / 100.f) * (N - 1) + .5f);
-  lo = std::clamp(lo, size_t(0), N - 1);
-  hi = std::clamp(hi, size_t(0), N - 1);
-  std::nth_element(buf.begin(), buf.begin() + lo, buf.end());
-  m_lowerValueStars = buf[lo];
-  std::nth_element(buf.begin(), buf.begin() + hi, buf.end());
-  m_upperValueStars = buf[hi];
+}
 
-  // If these are the same, fall back to min/max
-  if (m_lowerValueStars == m_upperValueStars) {
-    m_lowerValueStars = std::numeric_limits<float>::max();
-    m_upperValueStars = std::numeric_limits<float>::lowest();
-    for (float v : buf) {
-      m_lowerValueStars = std::min(m_lowerValueStars, v);
-      m_upperValueStars = std::max(m_upperValueStars, v);
+/**
+ * @brief Swaps finished background percentiles in, between two frames.
+ *
+ * Frames rendered ahead with the old bounds are dropped, so the very next
+ * frame already uses the new ones.
+ */
+void RotationFrameLoader::swapPercentiles() {
+  QMutexLocker lock(&m_stateMutex);
+  std::unique_ptr<PercentileJob> result;
+  {
+    QMutexLocker jobs(&m_percentileMutex);
+    result = std::move(m_percentileResult);
+  }
+  if (!result || result->generation != m_percentileGeneration.load())
+    return;
+
+  applyBinnedPercentiles(*result);
+  m_frameCache.clear();
+  invalidatePrefetch();
+}
+
+/**
+ * @brief Percentile thread: runs the latest queued job, one at a time.
+ */
+void RotationFrameLoader::percentileLoop() {
+  QMutexLocker lock(&m_percentileMutex);
+  while (!m_percentileStop) {
+    if (!m_percentileJob) {
+      m_percentileWake.wait(&m_percentileMutex);
+      continue;
+    }
+    std::unique_ptr<PercentileJob> job = std::move(m_percentileJob);
+    lock.unlock();
+
+    // serially: the render pool belongs to the frames on screen
+    bool complete = binPercentiles(*job, nullptr, 1);
+
+    lock.relock();
+    if (complete && job->generation == m_percentileGeneration.load()) {
+      m_percentileResult = std::move(job);
+      m_percentilesReady.store(true);
+
+      // nextRotationFrame() picks it up, unless the clock is paused
+      QMetaObject::invokeMethod(
+          this,
+          [this] {
+            if (!m_demanded && m_percentilesReady.exchange(false))
+              swapPercentiles();
+          },
+          Qt::QueuedConnection);
     }
   }
+}
 
-  // Now do the gas temperature dataset
-  dsetId = H5Dopen2(fileId, "gas_temperature", H5P_DEFAULT);
-  fileSpace = H5Dget_space(dsetId);
-  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr,
-                      (hsize_t[]){1, (hsize_t)m_xres, (hsize_t)m_yres},
-                      nullptr);
-  H5Dread(dsetId, H5T_NATIVE_FLOAT, memSpace, fileSpace, H5P_DEFAULT,
-          buf.data());
-  N = m_buf.size();
-  if (N == 0) {
-    m_lowerValueTemp = 0;
-    m_upperValueTemp = 1;
+/**
+ * @brief Reads the dataset's percentile pair off its histogram.
+ */
+void RotationFrameLoader::applyPercentiles(DatasetNormalization &norm) {
+  if (norm.histogram.isEmpty()) {
+    norm.lowerValue = 0;
+    norm.upperValue = 1;
     return;
   }
-  lo = size_t((m_percentileLowTemp / 100.f) * (N - 1) + .5f);
-  hi = size_t((m_percentileHighTemp / 100.f) * (N - 1) + .5f);
-  lo = std::clamp(lo, size_t(0), N - 1);
-  hi = std::clamp(hi, size_t(0), N - 1);
-  std::nth_element(buf.begin(), buf.begin() + lo, buf.end());
-  m_lowerValueTemp = buf[lo];
-  std::nth_element(buf.begin(), buf.begin() + hi, buf.end());
-  m_upperValueTemp = buf[hi];
+
+  std::vector<float> values =
+      norm.histogram.percentiles({norm.percentileLow, norm.percentileHigh});
+  norm.lowerValue = values[0];
+  norm.upperValue = values[1];
 
   // If these are the same, fall back to min/max
-  if (m_lowerValueTemp == m_upperValueTemp) {
-    m_lowerValueTemp = std::numeric_limits<float>::max();
-    m_upperValueTemp = std::numeric_limits<float>::lowest();
-    for (float v : buf) {
-      m_lowerValueTemp = std::min(m_lowerValueTemp, v);
-      m_upperValueTemp = std::max(m_upperValueTemp, v);
-    }
+  if (norm.lowerValue == norm.upperValue) {
+    norm.lowerValue = norm.histogram.minValue();
+    norm.upperValue = norm.histogram.maxValue();
   }
+}
 
-  // Close all HDF5 handles
-  H5Sclose(memSpace);
-  H5Sclose(fileSpace);
-  H5Dclose(dsetId);
-  H5Fclose(fileId);
+void RotationFrameLoader::setPercentileRange(float low, float high) {
+  QMutexLocker lock(&m_stateMutex);
+  DatasetNormalization *norm = normalization(m_currentDatasetKey);
+  if (!norm)
+    return;
+
+  norm->percentileLow = std::clamp(low, 0.0f, 100.0f);
+  norm->percentileHigh = std::clamp(high, 0.0f, 100.0f);
+  m_frameCache.clear();
+  m_normCache->setPercentiles(norm->key, norm->percentileLow,
+                              norm->percentileHigh);
+  if (norm->histogram.isEmpty())
+    computePercentiles();
+  else
+    applyPercentiles(*norm);
+
+  invalidatePrefetch();
+}
+
+void RotationFrameLoader::setImageDirectory(const QString &imageDirectory) {
+  if (imageDirectory == m_normDirectory)
+    return;
+  m_normDirectory = imageDirectory;
+  QMetaObject::invokeMethod(m_normCache, "setDirectory", Qt::QueuedConnection,
+                            Q_ARG(QString, imageDirectory));
+  QMetaObject::invokeMethod(m_packWriter, "setDirectory",
+                            Qt::QueuedConnection,
+                            Q_ARG(QString, imageDirectory));
+}
+
+void RotationFrameLoader::precomputeNormalization(int fileNumber) {
+  QMetaObject::invokeMethod(m_normCache, "precompute", Qt::QueuedConnection,
+                            Q_ARG(int, fileNumber));
+}
+
+void RotationFrameLoader::transcodeFramePack(int fileNumber) {
+  // called from the GUI thread: no m_stateMutex, which renders hold
+  if (!m_framePacks)
+    return;
+  QMetaObject::invokeMethod(m_packWriter, "transcode", Qt::QueuedConnection,
+                            Q_ARG(int, fileNumber));
+}
+
+void RotationFrameLoader::setExactPercentiles(bool exact) {
+  QMutexLocker lock(&m_stateMutex);
+  m_exactPercentiles = exact;
+}
+
+RotationFrameLoader::DatasetNormalization *
+RotationFrameLoader::normalization(const QString &datasetKey) {
+  for (DatasetNormalization &norm : m_norm) {
+    if (datasetKey == norm.key)
+      return &norm;
+  }
+  return nullptr;
+}
+
+const RotationFrameLoader::DatasetNormalization *
+RotationFrameLoader::normalization(const QString &datasetKey) const {
+  for (const DatasetNormalization &norm : m_norm) {
+    if (datasetKey == norm.key)
+      return &norm;
+  }
+  return nullptr;
 }
 
 void RotationFrameLoader::setColormap(int colormapIdx) {
+  colormapTable(colormapIdx, m_cmap, m_cmap_size);
+
+  // only rebuilds if the colormap actually changed
+  if (m_lut.update(m_cmap, m_cmap_size, stretchFor(m_currentDatasetKey),
+                   m_lutEntries))
+    m_frameCache.clear();
+}
+
+Stretch RotationFrameLoader::stretchFor(const QString &datasetKey) const {
+  const DatasetNormalization *norm = normalization(datasetKey);
+  return norm ? norm->stretch : Stretch();
+}
+
+/**
+ * @brief Brings the current and split-view tables up to date with the
+ * colormaps, stretches and LUT size.  Caller must hold m_stateMutex.
+ *
+ * @return true if any table was rebuilt.
+ */
+bool RotationFrameLoader::updateLuts() {
+  bool rebuilt = m_lut.update(m_cmap, m_cmap_size,
+                              stretchFor(m_currentDatasetKey), m_lutEntries);
+  for (Panel &panel : m_panels) {
+    const uint8_t (*cmap)[3] = nullptr;
+    size_t cmapSize = 0;
+    colormapTable(panel.colormapIdx, cmap, cmapSize);
+    rebuilt |= panel.lut.update(cmap, cmapSize, stretchFor(panel.key),
+                                m_lutEntries);
+  }
+  return rebuilt;
+}
+
+void RotationFrameLoader::setStretch(const QString &datasetKey,
+                                     const QString &stretch) {
+  QMutexLocker lock(&m_stateMutex);
+  DatasetNormalization *norm = normalization(datasetKey);
+  Stretch parsed;
+  if (!norm || !Stretch::parse(stretch, parsed)) {
+    qWarning() << "RotationFrameLoader: bad stretch" << stretch << "for"
+               << datasetKey;
+    return;
+  }
+  norm->stretch = parsed;
+  if (updateLuts()) {
+    m_frameCache.clear();
+    invalidatePrefetch();
+  }
+  qDebug() << "RotationFrameLoader:" << datasetKey << "stretch"
+           << parsed.toString();
+}
+
+/**
+ * @brief The colormaps.h table for a VizTabWidget::Colormap index.
+ */
+void RotationFrameLoader::colormapTable(int colormapIdx,
+                                        const uint8_t (*&cmap)[3],
+                                        size_t &size) {
   switch (colormapIdx) {
   case int(VizTabWidget::Colormap::Plasma):
-    m_cmap = plasma_colormap;
-    m_cmap_size = plasma_colormap_size;
+    cmap = plasma_colormap;
+    size = plasma_colormap_size;
     break;
   case int(VizTabWidget::Colormap::Magma):
-    m_cmap = magma_colormap_colormap;
-    m_cmap_size = magma_colormap_colormap_size;
+    cmap = magma_colormap_colormap;
+    size = magma_colormap_colormap_size;
     break;
   case int(VizTabWidget::Colormap::Viridis):
-    m_cmap = viridis_colormap_colormap;
-    m_cmap_size = viridis_colormap_colormap_size;
+    cmap = viridis_colormap_colormap;
+    size = viridis_colormap_colormap_size;
     break;
   case int(VizTabWidget::Colormap::Jet):
-    m_cmap = jet_colormap_colormap;
-    m_cmap_size = jet_colormap_colormap_size;
+    cmap = jet_colormap_colormap;
+    size = jet_colormap_colormap_size;
     break;
   case int(VizTabWidget::Colormap::Inferno):
-    m_cmap = inferno_colormap_colormap;
-    m_cmap_size = inferno_colormap_colormap_size;
+    cmap = inferno_colormap_colormap;
+    size = inferno_colormap_colormap_size;
     break;
   case int(VizTabWidget::Colormap::SpeakNow):
-    m_cmap = speaknow_colormap;
-    m_cmap_size = speaknow_colormap_size;
+    cmap = speaknow_colormap;
+    size = speaknow_colormap_size;
     break;
   case int(VizTabWidget::Colormap::Copper):
-    m_cmap = copper_colormap;
-    m_cmap_size = copper_colormap_size;
+    cmap = copper_colormap;
+    size = copper_colormap_size;
     break;
   case int(VizTabWidget::Colormap::Cosmic):
-    m_cmap = cosmic_colormap;
-    m_cmap_size = cosmic_colormap_size;
+    cmap = cosmic_colormap;
+    size = cosmic_colormap_size;
     break;
   case int(VizTabWidget::Colormap::Greyscale):
   default:
-    m_cmap = greyscale_colormap_colormap;
-    m_cmap_size = greyscale_colormap_colormap_size;
+    cmap = greyscale_colormap_colormap;
+    size = greyscale_colormap_colormap_size;
     break;
   }
 }
 
+void RotationFrameLoader::setLutSize(int entries) {
+  QMutexLocker lock(&m_stateMutex);
+  m_lutEntries = std::clamp(entries, int(ColormapLut::kMinEntries),
+                            int(ColormapLut::kMaxEntries));
+  if (updateLuts()) {
+    m_frameCache.clear();
+    invalidatePrefetch();
+  }
+}
+
+void RotationFrameLoader::setFrameCacheBudget(qint64 bytes) {
+  m_frameCache.setBudget(bytes);
+  sizeFramePool();
+}
+
+/**
+ * @brief Caps m_framePool at the frame cache budget plus the ring.
+ *
+ * Cached frames are pool buffers, so the cache and the pool share one
+ * budget: at the cap the pool takes the cache's oldest frame back instead
+ * of allocating, and frames the cache drops stay in the pool.  Rendering
+ * then stops allocating once the pool is full, however often the cache is
+ * cleared.
+ */
+void RotationFrameLoader::sizeFramePool() {
+  m_framePool->setBudget(m_frameCache.budget(),
+                         m_ring.capacity() + kFramesInFlight);
+}
+
+/**
+ * @brief Cache key for @p rotationFrame of the current file and settings.
+ * Caller must hold m_stateMutex.
+ */
+FrameKey RotationFrameLoader::frameKey(int rotationFrame) const {
+  FrameKey key;
+  key.fileNumber = m_currentFileNumber;
+  key.dataset = m_currentDatasetKey;
+  key.frameIndex = rotationFrame;
+  key.colormap = m_colormapIdx;
+  key.lutEntries = m_lutEntries;
+  key.min = float(minValue());
+  key.max = float(maxValue());
+  const Stretch stretch = stretchFor(m_currentDatasetKey);
+  key.stretchMode = int(stretch.mode);
+  key.stretch = stretch.param;
+  key.step = m_step;
+  key.block = m_block;
+  key.width = m_outYres;
+  key.height = m_outXres;
+  key.packed = m_packed != nullptr;
+
+  // split view: the layout and every panel's colormap and bounds
+  if (!m_panels.empty()) {
+    QStringList panels{QString::number(m_splitColumns)};
+    for (const Panel &panel : m_panels) {
+      const DatasetNormalization *norm = normalization(panel.key);
+      panels << QString("%1:%2:%3:%4:%5:%6")
+                    .arg(panel.key)
+                    .arg(panel.colormapIdx)
+                    .arg(norm ? norm->lowerValue : 0.0f)
+                    .arg(norm ? norm->upperValue : 1.0f)
+                    .arg(stretchFor(panel.key).toString())
+                    .arg(panel.packed ? "pack" : "float");
+    }
+    key.dataset = panels.join('|');
+  }
+  return key;
+}
+
 double RotationFrameLoader::minValue() const {
-  if (m_currentDatasetKey == "dark_matter")
-    return m_lowerValueDM;
-  else if (m_currentDatasetKey == "gas")
-    return m_lowerValueGas;
-  else if (m_currentDatasetKey == "stars")
-    return m_lowerValueStars;
-  else if (m_currentDatasetKey == "gas_temperature")
-    return m_lowerValueTemp;
-  else
-    return 0.0; // fallback
+  const DatasetNormalization *norm = normalization(m_currentDatasetKey);
+  return norm ? norm->lowerValue : 0.0; // fallback
 }
 
 double RotationFrameLoader::maxValue() const {
-  if (m_currentDatasetKey == "dark_matter")
-    return m_upperValueDM;
-  else if (m_currentDatasetKey == "gas")
-    return m_upperValueGas;
-  else if (m_currentDatasetKey == "stars")
-    return m_upperValueStars;
-  else if (m_currentDatasetKey == "gas_temperature")
-    return m_upperValueTemp;
-  else
-    return 1.0; // fallback
+  const DatasetNormalization *norm = normalization(m_currentDatasetKey);
+  return norm ? norm->upperValue : 1.0; // fallback
 }
 
 void RotationFrameLoader::nextRotationFrame() {
-  if (m_dsetId < 0 || m_nFrames <= 0)
+  // Frames whose deadline passed while we were busy are skipped rather than
+  // queued; the clock is re-armed for the next deadline, not a fixed period
+  int advance = m_scheduler.tick();
+  m_timer->start(m_scheduler.msUntilNext());
+
+  // The file we are switching to is open: hand over between two frames
+  if (m_loadPending && m_switchPrimed.load() == m_switchGeneration.load()) {
+    m_loadPending = false;
+    loadFile(m_pendingLoad);
+  }
+
+  // Background percentiles are done: new bounds from this frame on
+  if (m_percentilesReady.exchange(false))
+    swapPercentiles();
+
+  if (m_nFrames <= 0)
     return;
 
-  m_currentRotationFrame = (m_currentRotationFrame + 1) % m_nFrames;
+  m_currentRotationFrame = (m_currentRotationFrame + advance) % m_nFrames;
   loadNextFrame();
+
+  // Report pacing and caches every ~10 s; per-stage times are in the
+  // timings overlay (StageTimings)
+  if (lcLoaderStats().isDebugEnabled() &&
+      ++m_statsTicks >= 10 * m_scheduler.effectiveFps()) {
+    m_statsTicks = 0;
+    qCDebug(lcLoaderStats) << "RotationFrameLoader: pacing at"
+                           << m_scheduler.effectiveFps() << "of"
+                           << m_scheduler.nominalFps() << "fps,"
+                           << m_scheduler.lateFrames() << "late and"
+                           << m_scheduler.droppedFrames() << "dropped of"
+                           << m_scheduler.ticks() << "frames";
+    qCDebug(lcLoaderStats) << "RotationFrameLoader: frame lateness"
+                           << qPrintable(m_scheduler.takeJitterHistogram());
+    qCDebug(lcLoaderStats) << "RotationFrameLoader:"
+                           << m_rendersAvoided.load()
+                           << "renders avoided while hidden";
+    qCDebug(lcLoaderStats) << "RotationFrameLoader: ring hits"
+                           << m_ring.hits() << "misses" << m_ring.misses();
+    qCDebug(lcLoaderStats) << "RotationFrameLoader: handle pool hits"
+                           << m_handles.hits() << "misses"
+                           << m_handles.misses();
+    qCDebug(lcLoaderStats) << "RotationFrameLoader: frame cache hits"
+                           << m_frameCache.hits() << "misses"
+                           << m_frameCache.misses() << "evictions"
+                           << m_frameCache.evictions() << "using"
+                           << m_frameCache.bytes() / (1024 * 1024) << "MiB";
+    qCDebug(lcLoaderStats) << "RotationFrameLoader: frame buffers reused"
+                           << m_framePool->reused() << "allocated"
+                           << m_framePool->allocated() << "holding"
+                           << m_framePool->buffers();
+  }
+}
+
+void RotationFrameLoader::setRenderDemand(bool demanded) {
+  if (demanded == m_demanded)
+    return;
+  m_demanded = demanded;
+
+  if (!demanded) {
+    m_timer->stop();
+    if (m_nFrames > 0)
+      m_pauseClock.start();
+    qDebug() << "RotationFrameLoader: frames not shown, clock paused at frame"
+             << m_currentRotationFrame;
+
+    // nothing is on screen to keep rotating: a switch still being opened
+    // simply loads now, like every one queued while paused
+    if (m_loadPending) {
+      ++m_switchGeneration;
+      m_loadPending = false;
+      loadFile(m_pendingLoad);
+    }
+    return;
+  }
+
+  // every deadline that passed meanwhile, with a volume to rotate, is a
+  // frame we did not render
+  if (m_pauseClock.isValid()) {
+    const qint64 pausedMs = m_pauseClock.elapsed();
+    const quint64 avoided =
+        quint64(pausedMs * m_scheduler.effectiveFps() / 1000);
+    m_rendersAvoided += avoided;
+    m_pauseClock.invalidate();
+    qDebug() << "RotationFrameLoader: clock resumed after"
+             << pausedMs / 1000.0 << "s," << avoided << "renders avoided,"
+             << m_rendersAvoided.load() << "in total";
+  }
+
+  // picks up at the frame after the one it paused on; the read-ahead ring
+  // still holds it
+  m_scheduler.resume();
+  m_timer->start(m_scheduler.msUntilNext());
 }
 
 void RotationFrameLoader::loadNextFrame() {
-  if (m_dsetId < 0 || m_nFrames <= 0)
+  if (m_nFrames <= 0)
+    return;
+
+  // The common case: the prefetch stage already rendered this frame
+  RingFrame frame;
+  if (m_ring.tryPop(m_generation, m_currentRotationFrame, frame)) {
+    emit frameReady(frame.image, frame.fileNumber, frame.frameIndex,
+                    m_nFrames, StageTimings::now());
+    reportScrubLatency();
+    return;
+  }
+
+  // Ring miss: reuse a frame we showed before, or render on the tick, and
+  // restart prefetching behind us
+  {
+    QMutexLocker lock(&m_stateMutex);
+    FrameKey key = frameKey(m_currentRotationFrame);
+    if (!m_frameCache.find(key, m_img)) {
+      renderFrame(m_currentRotationFrame, m_buf, m_img);
+      m_frameCache.insert(key, m_img);
+    }
+    invalidatePrefetch();
+  }
+
+  emit frameReady(m_img, m_currentFileNumber, m_currentRotationFrame,
+                  m_nFrames, StageTimings::now());
+  reportScrubLatency();
+}
+
+/**
+ * @brief Logs how long scrubbing kept the screen waiting.
+ *
+ * Called after each frameReady.  Every jump's first frame is timed; once
+ * the knob has stopped, the first full-quality frame closes the gesture
+ * and the summary is logged.
+ */
+void RotationFrameLoader::reportScrubLatency() {
+  if (m_awaitFirstPixels) {
+    m_awaitFirstPixels = false;
+    qint64 ms = m_jumpClock.elapsed();
+    ++m_scrubJumps;
+    m_firstPixelsMsTotal += ms;
+    m_firstPixelsMsMax = std::max(m_firstPixelsMsMax, ms);
+  }
+  if (!m_awaitFinal)
+    return;
+
+  m_awaitFinal = false;
+  if (m_scrubJumps > 0)
+    qDebug() << "RotationFrameLoader: scrubbed" << m_scrubJumps
+             << "files, first pixels mean"
+             << m_firstPixelsMsTotal / m_scrubJumps << "ms max"
+             << m_firstPixelsMsMax << "ms; final image"
+             << m_stillClock.elapsed() << "ms after the knob stopped,"
+             << m_jumpClock.elapsed() << "ms after the last jump";
+  m_scrubJumps = 0;
+  m_firstPixelsMsTotal = 0;
+  m_firstPixelsMsMax = 0;
+}
+
+/**
+ * @brief Reads the volume of @p read into memory, then swaps it in.
+ *
+ * Runs on the prefetch thread without m_stateMutex, in slabs of about
+ * kPreloadSlabBytes with hdf5Mutex() held per slab only, so frames keep
+ * being rendered (and other HDF5 users served) in between.  Gives up if
+ * another file or dataset is loaded meanwhile.  Drops @p read's dataset
+ * reference.
+ */
+void RotationFrameLoader::preloadVolume(const VolumeRead &read) {
+  const size_t frameFloats = size_t(read.xres) * read.yres;
+  const size_t bytes = read.frames * frameFloats * sizeof(float);
+  auto superseded = [&] {
+    return m_ring.isStopped() ||
+           read.loadGeneration != m_loadGeneration.load();
+  };
+
+  PageBuffer volume;
+  bool ok = volume.allocate(bytes);
+  if (!ok)
+    qWarning() << "RotationFrameLoader: could not allocate" << bytes
+               << "bytes for volume preload.";
+
+  const int slabFrames = int(std::max<size_t>(
+      1, kPreloadSlabBytes / std::max<size_t>(frameFloats * sizeof(float), 1)));
+  float *dst = static_cast<float *>(volume.data());
+  for (int first = 0; ok && first < read.frames; first += slabFrames) {
+    if (superseded()) {
+      ok = false;
+      break;
+    }
+    const int count = std::min(slabFrames, read.frames - first);
+    QMutexLocker h5(&hdf5Mutex());
+    hid_t fileSpace = H5Dget_space(read.dsetId);
+    hsize_t offset[3] = {hsize_t(first), 0, 0};
+    hsize_t dims[3] = {hsize_t(count), hsize_t(read.xres), hsize_t(read.yres)};
+    H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr, dims,
+                        nullptr);
+    hid_t memSpace = H5Screate_simple(3, dims, nullptr);
+    if (fileSpace < 0 ||
+        H5Dread(read.dsetId, H5T_NATIVE_FLOAT, memSpace, fileSpace,
+                H5P_DEFAULT, dst + size_t(first) * frameFloats) < 0) {
+      qWarning() << "RotationFrameLoader: volume preload failed, streaming.";
+      ok = false;
+    }
+    H5Sclose(memSpace);
+    if (fileSpace >= 0)
+      H5Sclose(fileSpace);
+  }
+  {
+    QMutexLocker h5(&hdf5Mutex());
+    H5Idec_ref(read.dsetId);
+  }
+  if (!ok)
+    return;
+
+  QMutexLocker lock(&m_stateMutex);
+  if (superseded())
+    return;
+  m_volume.swap(volume);
+  qDebug() << "RotationFrameLoader: preloaded" << read.datasetKey << "of"
+           << "file" << read.fileNumber << "(" << bytes / (1024 * 1024)
+           << "MiB," << (m_volume.hugePages() ? "huge pages)" : "4K pages)");
+}
+
+/**
+ * @brief Picks the read decimation for the current target size.
+ *
+ * The step is the largest integer factor that still leaves at least as many
+ * pixels as the label shows; each output pixel averages a block x block
+ * box at the top-left of its step x step cell (block == step is a full box
+ * filter, 1 is point sampling).  Rebuilds the memspace and the reusable
+ * buffers.  Caller must hold m_stateMutex and hdf5Mutex().
+ *
+ * Slices are [x][y] row-major, as HDF5 stores them, and are drawn that way:
+ * image rows run along x, so the label's width is matched against y.
+ *
+ * @return true if the output dims or sampling changed.
+ */
+bool RotationFrameLoader::planDecimation() {
+  // in split view each panel gets one grid cell of the label
+  QSize target = m_targetSize;
+  if (!m_panels.empty() && !target.isEmpty())
+    target = QSize(target.width() / m_splitColumns,
+                   target.height() / splitRows());
+
+  int step = 1;
+  if (m_decimate && !target.isEmpty() && m_fullXres > 0) {
+    // the label keeps aspect ratio, so the tighter axis decides
+    double shown = std::max(double(m_fullYres) / target.width(),
+                            double(m_fullXres) / target.height());
+    step = std::clamp(int(shown), 1, std::min(m_fullXres, m_fullYres));
+  }
+  if (m_scrubbing && m_fullXres > 0)
+    step = std::min(step * m_scrubFactor, std::min(m_fullXres, m_fullYres));
+  int block = std::clamp(m_decimationBlock, 1, step);
+  int xres = m_fullXres / step;
+  int yres = m_fullYres / step;
+
+  // frames leave the loader at the size they are shown at
+  QSize out(yres, xres);
+  if (m_scaleToTarget && !target.isEmpty() && !out.isEmpty())
+    out = out.scaled(target, Qt::KeepAspectRatio);
+
+  bool changed = step != m_step || block != m_block || xres != m_xres ||
+                 yres != m_yres || out.height() != m_outXres ||
+                 out.width() != m_outYres || m_memSpace < 0;
+  if (!changed)
+    return false;
+
+  m_step = step;
+  m_block = block;
+  m_xres = xres;
+  m_yres = yres;
+  m_outXres = out.height();
+  m_outYres = out.width();
+  resampleTable(m_xres, m_outXres, m_resample.x0, m_resample.x1,
+                m_resample.wx);
+  resampleTable(m_yres, m_outYres, m_resample.y0, m_resample.y1,
+                m_resample.wy);
+
+  // the memspace holds the raw (still blocked) selection
+  if (m_memSpace >= 0)
+    H5Sclose(m_memSpace);
+  hsize_t count[3] = {1, hsize_t(m_xres) * m_block, hsize_t(m_yres) * m_block};
+  m_memSpace = H5Screate_simple(3, count, nullptr);
+
+  // reusable float buffer; images come from m_framePool as they are drawn
+  m_buf.assign(size_t(m_xres) * m_yres, 0.0f);
+  m_img = QImage();
+
+  if (m_step > 1)
+    qDebug() << "RotationFrameLoader: reading" << m_fullXres << "x"
+             << m_fullYres << "every" << m_step << "pixels with a" << m_block
+             << "x" << m_block << "box ->" << m_xres << "x" << m_yres;
+  if (m_outXres != m_xres || m_outYres != m_yres)
+    qDebug() << "RotationFrameLoader: resampling" << m_xres << "x" << m_yres
+             << "->" << m_outXres << "x" << m_outYres;
+  return true;
+}
+
+/**
+ * @brief Bilinear taps for one axis, pixel centers aligned.
+ *
+ * Output i reads source i0[i] and i1[i] = i0[i] + 1 (clamped at the edge)
+ * with weight w[i] on the latter.
+ */
+void RotationFrameLoader::resampleTable(int src, int out, std::vector<int> &i0,
+                                        std::vector<int> &i1,
+                                        std::vector<float> &w) {
+  i0.resize(size_t(std::max(out, 0)));
+  i1.resize(i0.size());
+  w.resize(i0.size());
+  const double scale = out > 0 ? double(src) / out : 1.0;
+  for (int i = 0; i < out; ++i) {
+    double pos = std::clamp((i + 0.5) * scale - 0.5, 0.0, double(src - 1));
+    int lo = int(pos);
+    i0[i] = lo;
+    i1[i] = std::min(lo + 1, src - 1);
+    w[i] = float(pos - lo);
+  }
+}
+
+void RotationFrameLoader::setScaleToTarget(bool enabled) {
+  QMutexLocker lock(&m_stateMutex);
+  m_scaleToTarget = enabled;
+  QMutexLocker h5(&hdf5Mutex());
+  if (m_fullXres > 0 && planDecimation()) {
+    h5.unlock();
+    invalidatePrefetch();
+  }
+}
+
+void RotationFrameLoader::setTargetSize(const QSize &size) {
+  QMutexLocker lock(&m_stateMutex);
+  m_targetSize = size;
+  QMutexLocker h5(&hdf5Mutex());
+  if (m_fullXres > 0 && planDecimation()) {
+    h5.unlock();
+    invalidatePrefetch();
+  }
+}
+
+void RotationFrameLoader::setDecimation(bool enabled, int block) {
+  QMutexLocker lock(&m_stateMutex);
+  m_decimate = enabled;
+  m_decimationBlock = std::max(block, 1);
+  QMutexLocker h5(&hdf5Mutex());
+  if (m_fullXres > 0 && planDecimation()) {
+    h5.unlock();
+    invalidatePrefetch();
+  }
+}
+
+void RotationFrameLoader::setScrubDecimation(int factor) {
+  QMutexLocker lock(&m_stateMutex);
+  m_scrubFactor = std::max(factor, 1);
+}
+
+void RotationFrameLoader::setScrubbing(bool scrubbing) {
+  QMutexLocker lock(&m_stateMutex);
+  if (scrubbing == m_scrubbing)
     return;
+  m_scrubbing = scrubbing;
+  if (!scrubbing) {
+    m_stillClock.start();
+    m_awaitFinal = true;
+  }
 
-  // read current slice
-  hsize_t offset[3] = {(hsize_t)m_currentRotationFrame, 0, 0};
-  H5Sselect_hyperslab(m_fileSpace, H5S_SELECT_SET, offset, nullptr,
-                      (hsize_t[]){1, (hsize_t)m_xres, (hsize_t)m_yres},
-                      nullptr);
-  H5Dread(m_dsetId, H5T_NATIVE_FLOAT, m_memSpace, m_fileSpace, H5P_DEFAULT,
-          m_buf.data());
-
-  // apply colormap into m_img
-  float min = minValue();
-  float max = maxValue();
+  // coarse frames rendered ahead are no use once the knob stops
+  QMutexLocker h5(&hdf5Mutex());
+  if (m_fullXres > 0 && planDecimation()) {
+    h5.unlock();
+    invalidatePrefetch();
+  }
+}
+
+namespace {
+
+/**
+ * @brief Box-filters a strided/blocked selection down to one value per cell.
+ *
+ * Output pixel (i, j) averages src[(i * step + a) * srcRowLength +
+ * j * step + b] for a, b < block.
+ */
+void boxAverage(const float *src, size_t srcRowLength, int step, int block,
+                int rows, int cols, float *dst) {
+  const float norm = 1.0f / float(block * block);
+  for (int i = 0; i < rows; ++i) {
+    float *out = dst + size_t(i) * cols;
+    if (block == 1) {
+      const float *row = src + size_t(i) * step * srcRowLength;
+      for (int j = 0; j < cols; ++j)
+        out[j] = row[size_t(j) * step];
+      continue;
+    }
+    std::fill(out, out + cols, 0.0f);
+    for (int a = 0; a < block; ++a) {
+      const float *row = src + (size_t(i) * step + a) * srcRowLength;
+      for (int j = 0; j < cols; ++j) {
+        const float *cell = row + size_t(j) * step;
+        float sum = 0.0f;
+        for (int b = 0; b < block; ++b)
+          sum += cell[b];
+        out[j] += sum;
+      }
+    }
+    for (int j = 0; j < cols; ++j)
+      out[j] *= norm;
+  }
+}
+
+/// Blanks a width x height box of an ARGB32 image (unused split cells).
+void fillBlack(uchar *origin, qsizetype bytesPerLine, int width, int height) {
+  for (int y = 0; y < height; ++y) {
+    quint32 *row = reinterpret_cast<quint32 *>(origin + y * bytesPerLine);
+    std::fill(row, row + width, 0xff000000u);
+  }
+}
+
+} // namespace
+
+/**
+ * @brief Reads one rotation frame and colormaps it into @p img.
+ *
+ * Caller must hold m_stateMutex.  @p buf is resized as needed, so each
+ * thread can keep its own; @p img is reused only if nobody else holds it
+ * and otherwise replaced by a buffer from the pool.  In split view every
+ * panel is read into @p buf in turn and colormapped into its grid cell.
+ */
+void RotationFrameLoader::renderFrame(int rotationFrame,
+                                      std::vector<float> &buf, QImage &img) {
+  StageTimer timer(StageTimings::Render);
+  const int columns = m_panels.empty() ? 1 : m_splitColumns;
+  const int rows = splitRows();
+  const int width = m_outYres * columns;
+  const int height = m_outXres * rows;
+  if (img.width() != width || img.height() != height || !img.isDetached() ||
+      img.format() != FramePool::kFormat)
+    img = m_framePool->acquire(width, height);
+
+  // grab the pointer once; scanLine() must not be called from the workers
+  uchar *bits = img.bits();
+  const qsizetype bytesPerLine = img.bytesPerLine();
+
+  QElapsedTimer renderClock;
+  qint64 renderNs = 0;
+  if (m_panels.empty()) {
+    renderClock.start();
+    const float *src = readSlice(rotationFrame, buf);
+    stageTimings().record(StageTimings::Read, renderClock.nsecsElapsed());
+    renderClock.start();
+    colormapRows(src, bits, bytesPerLine,
+                 renderParams(m_currentDatasetKey, m_lut),
+                 m_renderRow[int(stretchFor(m_currentDatasetKey).domain())]);
+    renderNs = renderClock.nsecsElapsed();
+  } else {
+    for (int cell = 0; cell < columns * rows; ++cell) {
+      uchar *origin = bits + qsizetype(cell / columns) * m_outXres *
+                                 bytesPerLine +
+                      qsizetype(cell % columns) * m_outYres * 4;
+      if (cell >= int(m_panels.size())) {
+        fillBlack(origin, bytesPerLine, m_outYres, m_outXres);
+        continue;
+      }
+
+      // the current dataset keeps its mapped / preloaded / decoded path
+      Panel &panel = m_panels[size_t(cell)];
+      QElapsedTimer panelClock;
+      panelClock.start();
+      const float *src = panel.key == m_currentDatasetKey
+                             ? readSlice(rotationFrame, buf)
+                             : readPanelSlice(panel, rotationFrame, buf);
+      stageTimings().record(StageTimings::Read, panelClock.nsecsElapsed());
+      if (!src) {
+        fillBlack(origin, bytesPerLine, m_outYres, m_outXres);
+        continue;
+      }
+      renderClock.start();
+      colormapRows(src, origin, bytesPerLine,
+                   renderParams(panel.key, panel.lut),
+                   m_renderRow[int(stretchFor(panel.key).domain())]);
+      renderNs += renderClock.nsecsElapsed();
+    }
+  }
+
+  stageTimings().record(StageTimings::Colormap, renderNs);
+  m_lastRenderNs.store(renderNs, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Reads one rotation frame of the current dataset, decimated.
+ *
+ * Takes the slice from the preloaded or mapped volume, the frame pack, the
+ * chunk decoder or a hyperslab read, in that order.  Caller must hold
+ * m_stateMutex.  When decimating, @p buf holds the filtered slice followed
+ * by the raw blocked selection (or the full slice for the chunk decoder).
+ *
+ * @return the m_xres x m_yres slice, in @p buf or the volume.
+ */
+const float *RotationFrameLoader::readSlice(int rotationFrame,
+                                            std::vector<float> &buf) {
+  const size_t pixels = size_t(m_xres) * m_yres;
+  const size_t fullPixels = size_t(m_fullXres) * m_fullYres;
+  size_t raw = 0;
+  if (m_step > 1)
+    raw = m_decoder.isAttached() || m_packed ? fullPixels
+                                             : pixels * m_block * m_block;
+  buf.resize(pixels + raw);
+
+  const void *volume = !m_volume.isNull() ? m_volume.data() : m_mapped.data();
+  if (volume) {
+    const float *src =
+        static_cast<const float *>(volume) + rotationFrame * fullPixels;
+    if (m_volume.isNull()) {
+      // keep the kernel reading ahead in rotation order, across the wrap
+      int ahead = (rotationFrame + kMappedReadAhead) % m_nFrames;
+      m_mapped.willNeed(ahead * fullPixels * sizeof(float),
+                        fullPixels * sizeof(float));
+    }
+    if (m_step == 1)
+      return src;
+    boxAverage(src, size_t(m_fullYres), m_step, m_block, m_xres, m_yres,
+               buf.data());
+    return buf.data();
+  }
+
+  float *dst = buf.data() + (m_step > 1 ? pixels : 0);
+
+  // a pack is dequantized from the mapping; compressed chunks are fetched
+  // raw and decoded on the render pool
+  bool decoded = false;
+  if (m_packed) {
+    m_pack.decodeFrame(*m_packed, rotationFrame, dst);
+    m_pack.willNeed(*m_packed, (rotationFrame + kMappedReadAhead) % m_nFrames);
+    decoded = true;
+    if (m_step > 1)
+      boxAverage(dst, size_t(m_fullYres), m_step, m_block, m_xres, m_yres,
+                 buf.data());
+  } else if (m_decoder.isAttached()) {
+    decoded = m_decoder.readFrame(rotationFrame, dst, &m_renderPool,
+                                  m_renderThreads);
+    if (!decoded) {
+      qWarning() << "RotationFrameLoader: chunk decode failed, using"
+                 << "H5Dread for" << m_currentDatasetKey;
+      m_decoder.detach();
+      buf.resize(pixels + (m_step > 1 ? pixels * m_block * m_block : 0));
+      dst = buf.data() + (m_step > 1 ? pixels : 0);
+    } else if (m_step > 1) {
+      boxAverage(dst, size_t(m_fullYres), m_step, m_block, m_xres, m_yres,
+                 buf.data());
+    }
+  }
+
+  if (!decoded) {
+    readHyperslab(m_dsetId, m_fileSpace, rotationFrame, dst);
+    if (m_step > 1)
+      boxAverage(dst, size_t(m_yres) * m_block, m_block, m_block, m_xres,
+                 m_yres, buf.data());
+  }
+  return buf.data();
+}
+
+/**
+ * @brief Reads one rotation frame of another split-view dataset.
+ *
+ * Same decimation as the current dataset, from the pack if it has one and
+ * otherwise with a hyperslab read.  Caller must hold m_stateMutex.
+ *
+ * @return the slice in @p buf, or nullptr if the panel has no data.
+ */
+const float *RotationFrameLoader::readPanelSlice(const Panel &panel,
+                                                 int rotationFrame,
+                                                 std::vector<float> &buf) {
+  if (!panel.packed && panel.dsetId < 0)
+    return nullptr;
+
+  const size_t pixels = size_t(m_xres) * m_yres;
+  size_t raw = 0;
+  if (m_step > 1)
+    raw = panel.packed ? size_t(m_fullXres) * m_fullYres
+                       : pixels * m_block * m_block;
+  buf.resize(pixels + raw);
+  float *dst = buf.data() + (m_step > 1 ? pixels : 0);
+
+  if (panel.packed) {
+    m_pack.decodeFrame(*panel.packed, rotationFrame, dst);
+    m_pack.willNeed(*panel.packed,
+                    (rotationFrame + kMappedReadAhead) % m_nFrames);
+    if (m_step > 1)
+      boxAverage(dst, size_t(m_fullYres), m_step, m_block, m_xres, m_yres,
+                 buf.data());
+  } else {
+    readHyperslab(panel.dsetId, panel.fileSpace, rotationFrame, dst);
+    if (m_step > 1)
+      boxAverage(dst, size_t(m_yres) * m_block, m_block, m_block, m_xres,
+                 m_yres, buf.data());
+  }
+  return buf.data();
+}
+
+/**
+ * @brief H5Dread of the sampled blocks of one frame into m_memSpace.
+ *
+ * Only the sampled blocks are read: stride = step, block = block.
+ */
+void RotationFrameLoader::readHyperslab(hid_t dsetId, hid_t fileSpace,
+                                        int rotationFrame, float *dst) {
+  QMutexLocker h5(&hdf5Mutex());
+  hsize_t offset[3] = {(hsize_t)rotationFrame, 0, 0};
+  hsize_t stride[3] = {1, (hsize_t)m_step, (hsize_t)m_step};
+  hsize_t count[3] = {1, (hsize_t)m_xres, (hsize_t)m_yres};
+  hsize_t block[3] = {1, (hsize_t)m_block, (hsize_t)m_block};
+  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset,
+                      m_step > 1 ? stride : nullptr, count,
+                      m_step > 1 ? block : nullptr);
+  H5Dread(dsetId, H5T_NATIVE_FLOAT, m_memSpace, fileSpace, H5P_DEFAULT, dst);
+}
+
+/**
+ * @brief Normalization into @p lut for @p datasetKey: one subtract, one
+ * multiply and a load per pixel, vectorized for this CPU (see
+ * RenderKernels.h).  Log stretches normalize on the log2 index axis.
+ */
+RenderParams RotationFrameLoader::renderParams(const QString &datasetKey,
+                                               const ColormapLut &lut) const {
+  const DatasetNormalization *norm = normalization(datasetKey);
+  float min = norm ? norm->lowerValue : 0.0f;
+  float max = norm ? norm->upperValue : 1.0f;
+  if (stretchFor(datasetKey).domain() == IndexDomain::Log2) {
+    max = std::max(max, std::numeric_limits<float>::min());
+    min = std::max(min, max * std::pow(10.0f, -kLogStretchDecades));
+    min = indexValue<IndexDomain::Log2>(min);
+    max = indexValue<IndexDomain::Log2>(max);
+  }
   float range = max - min;
   if (range <= 0)
     range = 1.0f;
 
-  // pick your stretch strength (higher → more pop in the shadows)
-  constexpr float asinhStretchFactor = 9.0f;
-  // precompute denominator so we only call asinh() once
-  const float asinhNormalizationDenominator = std::asinh(asinhStretchFactor);
-
-  // compute int upper bound for clamp exactly once
-  int maxColorMapIndex = static_cast<int>(m_cmap_size) - 1;
-
-  for (int y = 0; y < m_yres; ++y) {
-    uchar *scanLine = m_img.scanLine(y);
-
-    for (int x = 0; x < m_xres; ++x) {
-      float rawBufferValue = m_buf[y * m_xres + x];
-
-      if (rawBufferValue <= 0.0f) {
-        // background
-        scanLine[3 * x + 0] = 0;
-        scanLine[3 * x + 1] = 0;
-        scanLine[3 * x + 2] = 0;
-      } else {
-        // 1) linear normalize
-        float normalizedValue = (rawBufferValue - min) / range;
-        normalizedValue = std::clamp(normalizedValue, 0.0f, 1.0f);
-
-        // 2) arcsinh stretch
-        float stretchedValue =
-            std::asinh(asinhStretchFactor * normalizedValue) /
-            asinhNormalizationDenominator;
-        stretchedValue = std::clamp(stretchedValue, 0.0f, 1.0f);
-
-        // 3) map into colormap
-        int colorMapIndex = int(stretchedValue * maxColorMapIndex + 0.5f);
-        colorMapIndex = std::clamp(colorMapIndex, 0, maxColorMapIndex);
-
-        const uint8_t *rgbTriplet = m_cmap[colorMapIndex];
-        scanLine[3 * x + 0] = rgbTriplet[0];
-        scanLine[3 * x + 1] = rgbTriplet[1];
-        scanLine[3 * x + 2] = rgbTriplet[2];
+  RenderParams params;
+  params.min = min;
+  params.scale = float(lut.size()) / range;
+  params.maxIndex = float(lut.size() - 1);
+  params.lut = lut.data();
+  return params;
+}
+
+/**
+ * @brief Colormaps one frame (or split-view cell) at @p bits, split into
+ * row tiles across the pool.
+ *
+ * @p src is m_xres rows of m_yres samples; the image gets m_outXres rows of
+ * m_outYres pixels, bilinearly resampled through m_resample if the sizes
+ * differ: the two source rows are blended, then interpolated along the row
+ * (m_resampleRow).
+ *
+ * The calling thread works on tiles too, so a cap of N uses N-1 pool
+ * threads.  Tiles are handed out dynamically to even out uneven rows.
+ */
+void RotationFrameLoader::colormapRows(const float *src, uchar *bits,
+                                       qsizetype bytesPerLine,
+                                       const RenderParams &params,
+                                       RenderRowFn renderRow) {
+  const int width = m_outYres;
+  const int height = m_outXres;
+  const int srcRowLength = m_yres;
+  const bool resample = height != m_xres || width != m_yres;
+  const ResampleTable *table = &m_resample;
+  const ResampleTaps taps{table->y0.data(), table->y1.data(),
+                          table->wy.data(), int(table->y0.size())};
+  const ResampleRowFn resampleRow = m_resampleRow;
+
+  auto renderRange = [=, &params](int y0, int y1) {
+    // per-thread scratch rows, grown once
+    thread_local std::vector<float> blended, row;
+    if (resample) {
+      blended.resize(size_t(srcRowLength));
+      row.resize(size_t(width));
+    }
+    for (int y = y0; y < y1; ++y) {
+      const float *in = src + size_t(y) * srcRowLength;
+      if (resample) {
+        resampleRow(src + size_t(table->x0[y]) * srcRowLength,
+                    src + size_t(table->x1[y]) * srcRowLength, table->wx[y],
+                    srcRowLength, taps, blended.data(), row.data());
+        in = row.data();
       }
+      renderRow(in, reinterpret_cast<uint32_t *>(bits + y * bytesPerLine),
+                width, params);
     }
+  };
+
+  const int threads = std::min(m_renderThreads, height / kRowsPerTile);
+  if (threads <= 1) {
+    renderRange(0, height);
+    return;
   }
 
-  emit frameReady(m_img, m_currentFileNumber, m_currentRotationFrame,
-                  m_nFrames);
+  const int tiles = (height + kRowsPerTile - 1) / kRowsPerTile;
+  std::atomic<int> nextTile{0};
+  auto work = [&] {
+    for (int t = nextTile.fetch_add(1); t < tiles; t = nextTile.fetch_add(1))
+      renderRange(t * kRowsPerTile, std::min(height, (t + 1) * kRowsPerTile));
+  };
+
+  QSemaphore done;
+  for (int i = 1; i < threads; ++i) {
+    m_renderPool.start([&] {
+      work();
+      done.release();
+    });
+  }
+  work();
+  done.acquire(threads - 1);
+}
+
+void RotationFrameLoader::setRenderThreads(int threads) {
+  QMutexLocker lock(&m_stateMutex);
+  m_renderThreads = std::clamp(threads, 1, QThread::idealThreadCount());
+  m_renderPool.setMaxThreadCount(std::max(1, m_renderThreads - 1));
 }
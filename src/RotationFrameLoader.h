@@ -1,22 +1,90 @@
 // RotationFrameLoader.h
 #pragma once
 
+#include "ChunkDecoder.h"
+#include "ColormapLut.h"
+#include "FrameCache.h"
+#include "FramePack.h"
+#include "FramePool.h"
+#include "FrameRing.h"
+#include "FrameScheduler.h"
+#include "Hdf5HandlePool.h"
+#include "MappedFile.h"
+#include "PageBuffer.h"
+#include "PercentileEngine.h"
+#include "RenderKernels.h"
+#include <QElapsedTimer>
 #include <QImage>
+#include <QList>
+#include <QMutex>
 #include <QObject>
+#include <QSize>
 #include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
 #include <QTimer>
+#include <QWaitCondition>
+#include <array>
+#include <atomic>
 #include <hdf5.h>
+#include <memory>
 #include <vector>
 
+class FramePackWriter;
+class NormalizationCache;
+
 /**
  * @brief Loads and rotates through frames stored in an HDF5 volume.
  *
- * Emits frameReady() at a fixed fps.  You can:
+ * Emits frameReady() at a fixed fps while a consumer shows the frames
+ * (setRenderDemand()); otherwise the clock stands still.  You can:
  *   • startLoading(...) to open a new file (with optional percentile recompute)
  *   • jumpToFile(...)   to switch files under the same rotation clock
  *
- * Internally we cache the HDF5 dataset, file‐space, and mem‐space, and reuse
- * a pair of float buffers + QImage to avoid heap churn.
+ * Internally we cache the HDF5 dataset, file‐space, and mem‐space, and keep
+ * recently visited files open in an LRU Hdf5HandlePool so scrubbing back
+ * and forth with the knob doesn't reopen anything.  A file that is not
+ * open yet is opened, and the frames about to be shown read once, on a
+ * switch thread while the current file keeps rotating; the switch itself
+ * happens at the next tick.  Newly arrived files are pre-warmed the same
+ * way.  A
+ * background prefetch stage reads and colormaps frames N+1..N+k into a
+ * read-ahead ring while frame N is on screen, so the timer tick only pops a
+ * ready QImage (falling back to a synchronous render on a ring miss).
+ *
+ * Volumes that fit under the preload limit are read whole, with a single
+ * H5Dread into a page-aligned buffer, once the file has been current for a
+ * short settle time; after that rotation only touches memory.  Contiguous,
+ * unfiltered float datasets skip HDF5 for the data entirely: the raw bytes
+ * are memory mapped and each frame is a pointer into the page cache.
+ * Compressed (shuffle/deflate) chunks are fetched raw and decoded on the
+ * render pool rather than serially inside H5Dread.
+ *
+ * Optionally (setFramePacks(), --frame-packs) new files are transcoded in
+ * the background into a FramePack sidecar (uint16, log-quantized); when a
+ * current pack exists it is mapped instead of opening the HDF5 file at
+ * all.  Packs trade exactness for speed: percentiles and bounds are still
+ * taken from the HDF5 floats, but the pixels compared against them are
+ * quantized, so a value within one code step (a relative 1/65534 of the
+ * frame's log range) of a bound may clamp differently than the float
+ * would.  Off by default.
+ *
+ * In split view several datasets of the same file are drawn side by side
+ * into one frame: they share the file handles, the rotation clock, the
+ * decimation plan and the render pool, so each extra panel costs one slice
+ * read and one colormap pass.
+ *
+ * Finished frames also go into a byte-budgeted FrameCache keyed on file,
+ * dataset, frame and every render setting, so scrubbing back over files
+ * already shown skips HDF5 and the colormap entirely.
+ *
+ * Normalization bounds are looked up in a NormalizationCache first.  The
+ * cache is persisted next to the images and filled for every new file by a
+ * low-priority background job, so restarts and idle resets rarely have to
+ * read and bin the latest file themselves.  When they do, the binning runs
+ * on a low-priority percentile thread while rotation carries on with the
+ * old bounds; the new ones are swapped in between two frames.
  */
 class RotationFrameLoader : public QObject {
   Q_OBJECT
@@ -30,7 +98,60 @@ public:
   /// Set the latest available file number.
   void setLatestFileNumber(int fileNumber) { m_latestFileNumber = fileNumber; }
 
+  /// Memory budget for rendered frames kept across files (0 disables).
+  void setFrameCacheBudget(qint64 bytes);
+
+  /// Frame cache statistics.
+  quint64 frameCacheHits() const { return m_frameCache.hits(); }
+  quint64 frameCacheMisses() const { return m_frameCache.misses(); }
+  quint64 frameCacheEvictions() const { return m_frameCache.evictions(); }
+
+  /// Decode filtered chunks on the render pool (next file onwards).
+  void setParallelDecode(bool enabled);
+
+  /// Map contiguous float datasets instead of H5Dread (next file onwards).
+  void setMappedReads(bool enabled);
+
+  /// Read frame packs where present (next file onwards) and write new ones.
+  /// Off by default: packed pixels are quantized (see above).
+  void setFramePacks(bool enabled);
+
+  /// Set how many files the handle pool keeps open (2–64).
+  void setHandlePoolSize(int files);
+
+  /// Handle pool statistics: file switches that needed no H5Fopen vs did.
+  quint64 handlePoolHits() const { return m_handles.hits(); }
+  quint64 handlePoolMisses() const { return m_handles.misses(); }
+
+  /// Set how many frames the prefetch stage renders ahead (2–64).
+  void setReadAheadDepth(int depth);
+
+  /// Ring statistics: frames that were ready on time vs rendered on the tick.
+  quint64 ringHits() const { return m_ring.hits(); }
+  quint64 ringMisses() const { return m_ring.misses(); }
+
+  /// Largest volume (bytes) read whole into memory; 0 disables preloading.
+  void setPreloadLimit(qint64 bytes);
+
+  /// Number of entries in the stretch+colormap table (4096–65536).
+  void setLutSize(int entries);
+
+  /// Cap the threads used to colormap one frame (1 = render serially).
+  void setRenderThreads(int threads);
+
+  /// Wall time of the most recent frame's colormap pass, in nanoseconds.
+  qint64 lastRenderNs() const { return m_lastRenderNs.load(); }
+
+  /// Frames the clock would have rendered while nobody was watching.
+  quint64 rendersAvoided() const { return m_rendersAvoided.load(); }
+
 public slots:
+  /**
+   * @brief Show @p datasetKey of image_<fileNumber>.hdf5.
+   *
+   * Switching to a file that is not open yet while another one rotates
+   * hands over at the first tick after the background open finished.
+   */
   void startLoading(const QString &imageDirectory, int fileNumber,
                     const QString &datasetKey, int colormapIdx, int fps,
                     bool keepPercentiles = false);
@@ -40,64 +161,377 @@ public slots:
    */
   void jumpToFile(int fileNumber, bool keepPercentiles);
 
+  /**
+   * @brief Show several datasets of the current file at once.
+   *
+   * @p datasets are laid out in a grid @p columns wide (2 for 2x2, N for
+   * 1xN), each with its own colormap and normalization but read from the
+   * same file and rotation frame.  An empty list goes back to showing the
+   * current dataset alone.
+   */
+  void setSplitView(const QStringList &datasets, const QList<int> &colormaps,
+                    int columns);
+
+  /**
+   * @brief Change the current dataset's percentile pair.
+   *
+   * Answered from the cached histogram of the latest file, so no HDF5 reads
+   * are needed unless nothing has been binned yet; then the new bounds
+   * arrive from the percentile thread a few frames later.
+   */
+  void setPercentileRange(float low, float high);
+
+  /// Keep slice data so percentiles are refined to exact ranks.  Exact
+  /// bounds bypass the NormalizationCache, which holds estimates only.
+  void setExactPercentiles(bool exact);
+
+  /**
+   * @brief Physical pixel size the frames are shown at.
+   *
+   * With decimation on, slices are read with a strided hyperslab and
+   * box-filtered down to roughly this size instead of read in full.
+   */
+  void setTargetSize(const QSize &size);
+
+  /// HDF5 page buffer per file (0 = off); only used for paged files.
+  void setPageBufferSize(qint64 bytes);
+
+  /**
+   * @brief Emit frames already scaled to the target size.
+   *
+   * The (decimated) slice is bilinearly resampled inside the tiled
+   * colormap pass, so the label only has to blit.  Off emits the decimated
+   * size and leaves scaling to the label.
+   */
+  void setScaleToTarget(bool enabled);
+
+  /// Enable decimated reads; @p block (1..step) is the box filter width.
+  void setDecimation(bool enabled, int block = 2);
+
+  /**
+   * @brief Progressive rendering: coarse frames while the knob is moving.
+   *
+   * While scrubbing, reads are decimated @p factor times further than the
+   * target size asks for (1 = off), so each file shows up right away;
+   * setScrubbing(false) refines back to full quality.
+   */
+  void setScrubDecimation(int factor);
+
+  /// The knob started (true) or stopped (false) moving.
+  void setScrubbing(bool scrubbing);
+
+  /**
+   * @brief Whether anybody is showing the frames.
+   *
+   * Without demand the rotation clock is stopped, so nothing is read or
+   * colormapped; the rotation resumes where it paused.  Off until the
+   * first consumer shows up.
+   */
+  void setRenderDemand(bool demanded);
+
+  /// Point the normalization cache at the images directory.
+  void setImageDirectory(const QString &imageDirectory);
+
+  /// Queue a background normalization precompute for a newly seen file.
+  void precomputeNormalization(int fileNumber);
+
+  /// Queue a background frame-pack transcode for a newly seen file.
+  void transcodeFramePack(int fileNumber);
+
+  /// Open and prime a newly seen file in the background, ahead of a switch.
+  void prewarmFile(int fileNumber);
+
+  /**
+   * @brief Set the stretch curve of one dataset (see Stretch::parse()).
+   *
+   * Only rebuilds the colormap tables; log stretches switch to the log2
+   * render kernels.
+   */
+  void setStretch(const QString &datasetKey, const QString &stretch);
+
 signals:
+  /// @p emittedNs is StageTimings::now() at the emit, to time delivery.
   void frameReady(const QImage &img, int fileNumber, int frameIndex,
-                  int totalFrames);
+                  int totalFrames, qint64 emittedNs);
   void percentChanged(int step);
   void ageChanged(long long age); // in Gyrs
 
 private:
+  struct LoadRequest;
+  void loadFile(const LoadRequest &request);
+  bool queueSwitch(const LoadRequest &request);
+  struct SwitchJob;
+  std::unique_ptr<SwitchJob> switchJob(const QString &path,
+                                       const QString &datasetKey) const;
+  void primeFile(const SwitchJob &job);
+  void switchLoop();
+  struct DatasetNormalization;
+  struct PercentileJob;
   void computePercentiles();
+  bool binPercentiles(PercentileJob &job, QThreadPool *pool, int threads);
+  void applyBinnedPercentiles(PercentileJob &job);
+  void swapPercentiles();
+  void percentileLoop();
+  void applyPercentiles(DatasetNormalization &norm);
+  DatasetNormalization *normalization(const QString &datasetKey);
+  const DatasetNormalization *normalization(const QString &datasetKey) const;
   void setColormap(int colormapIdx);
+  Stretch stretchFor(const QString &datasetKey) const;
+  bool updateLuts();
+  static void colormapTable(int colormapIdx, const uint8_t (*&cmap)[3],
+                            size_t &size);
+  void setAge(double age);
   void nextRotationFrame();
   void loadNextFrame();
 
-  // HDF5 handles
+  // Read-ahead stage
+  void startPrefetch();
+  void prefetchLoop();
+  void invalidatePrefetch();
+  void renderFrame(int rotationFrame, std::vector<float> &buf, QImage &img);
+  struct Panel;
+  const float *readSlice(int rotationFrame, std::vector<float> &buf);
+  void readHyperslab(hid_t dsetId, hid_t fileSpace, int rotationFrame,
+                     float *dst);
+  const float *readPanelSlice(const Panel &panel, int rotationFrame,
+                              std::vector<float> &buf);
+  RenderParams renderParams(const QString &datasetKey,
+                            const ColormapLut &lut) const;
+  void colormapRows(const float *src, uchar *bits, qsizetype bytesPerLine,
+                    const RenderParams &params, RenderRowFn renderRow);
+  void openPanels(const QString &path, Hdf5FileHandles *file);
+  int splitRows() const;
+  bool planDecimation();
+  struct ResampleTable;
+  static void resampleTable(int src, int out, std::vector<int> &i0,
+                            std::vector<int> &i1, std::vector<float> &w);
+  void reportScrubLatency();
+  FrameKey frameKey(int rotationFrame) const;
+  void sizeFramePool();
+  struct VolumeRead;
+  void preloadVolume(const VolumeRead &read);
+
+  // HDF5 handles; file/dataset/file-space are borrowed from m_handles
+  Hdf5HandlePool m_handles;
   hid_t m_fileId = -1;
   hid_t m_dsetId = -1;
   hid_t m_fileSpace = -1;
   hid_t m_memSpace = -1;
 
+  // asynchronous file switch: startLoading() parks a switch to a file that
+  // is not open yet in m_pendingLoad, the switch thread opens it (and its
+  // next frames) into m_stagingHandles, and the tick after that runs the
+  // load, which moves the bundle into m_handles.  Pre-warms of new files
+  // (generation 0) go into the same staging pool but load nothing.
+  struct LoadRequest {
+    QString imageDirectory;
+    int fileNumber = -1;
+    QString datasetKey;
+    int colormapIdx = 0;
+    int fps = 25;
+    bool keepPercentiles = false;
+  };
+  struct SwitchJob {
+    int generation = 0;
+    QString path;
+    QStringList datasets; // the first one has its next frames read
+    int firstFrame = 0;
+  };
+  static constexpr int kPrimeFrames = 4;
+  Hdf5HandlePool m_stagingHandles{2};
+  QThread *m_switchThread = nullptr;
+  QMutex m_switchMutex; // guards the jobs and the stop flag
+  QWaitCondition m_switchWake;
+  std::unique_ptr<SwitchJob> m_switchJob;
+  std::unique_ptr<SwitchJob> m_prewarmJob;
+  bool m_switchStop = false;
+  std::atomic<int> m_switchGeneration{0};
+  std::atomic<int> m_switchPrimed{0}; // generation of the last primed switch
+  LoadRequest m_pendingLoad;          // loader thread only
+  bool m_loadPending = false;
+
   // directory + dataset
   QString m_imageDirectory;
   QString m_currentDatasetKey;
   int m_currentFileNumber = -1;
   int m_latestFileNumber = -1;
 
-  // normalization
-  float m_percentileLowDM = 5.0f;       // Dark matter default
-  float m_percentileHighDM = 99.99f;    // Dark matter default
-  float m_percentileLowGas = 5.0f;      // Gas default
-  float m_percentileHighGas = 99.99f;   // Gas default
-  float m_percentileLowStars = 5.0f;    // Stars default
-  float m_percentileHighStars = 99.99f; // Stars default
-  float m_percentileLowTemp = 5.0f;     // Temperature default
-  float m_percentileHighTemp = 99.99f;  // Temperature default
-  float m_lowerValueDM = 0.0f;          // Dark matter default
-  float m_upperValueDM = 1.0f;          // Dark matter default
-  float m_lowerValueGas = 0.0f;         // Gas default
-  float m_upperValueGas = 1.0f;         // Gas default
-  float m_lowerValueStars = 0.0f;       // Stars default
-  float m_upperValueStars = 1.0f;       // Stars default
-  float m_lowerValueTemp = 0.0f;        // Temperature default
-  float m_upperValueTemp = 1.0f;        // Temperature default
-
-  // volume dims
+  // normalization: percentile settings, resulting bounds, the slice-0
+  // histogram of the latest file and the stretch curve, per dataset
+  struct DatasetNormalization {
+    const char *key;
+    float percentileLow = 5.0f;
+    float percentileHigh = 99.99f;
+    float lowerValue = 0.0f;
+    float upperValue = 1.0f;
+    bool cached = false; // bounds came from m_normCache, histogram is empty
+    bool hasBounds = false; // bounds come from data, not the 0..1 fallback
+    PercentileEngine histogram;
+    Stretch stretch;
+  };
+  std::array<DatasetNormalization, 4> m_norm{{{"dark_matter"},
+                                              {"gas"},
+                                              {"stars"},
+                                              {"gas_temperature"}}};
+  bool m_exactPercentiles = false;
+
+  // background percentiles: computePercentiles() queues a job (a newer one
+  // replaces it), the percentile thread reads and bins the latest file, and
+  // nextRotationFrame() swaps the result in.  Results of superseded jobs are
+  // dropped by generation.
+  struct PercentileJob {
+    struct Dataset {
+      QString key;
+      float percentileLow = 0.0f;
+      float percentileHigh = 100.0f;
+      PercentileEngine histogram;
+    };
+    int generation = 0;
+    int fileNumber = -1;
+    QString path;
+    bool exact = false;
+    std::vector<Dataset> datasets;
+  };
+  QThread *m_percentileThread = nullptr;
+  QMutex m_percentileMutex; // guards the job, the result and the stop flag
+  QWaitCondition m_percentileWake;
+  std::unique_ptr<PercentileJob> m_percentileJob;
+  std::unique_ptr<PercentileJob> m_percentileResult;
+  bool m_percentileStop = false;
+  std::atomic<int> m_percentileGeneration{0};
+  std::atomic<bool> m_percentilesReady{false};
+
+  // split view: datasets drawn side by side, row-major in m_splitColumns
+  // columns; each cell is m_outXres rows of m_outYres.  A panel showing the
+  // current dataset reads through the main path (mapped, preloaded, ...),
+  // the others from a pack or a hyperslab of the same file.
+  struct Panel {
+    QString key;
+    int colormapIdx = 0;
+    ColormapLut lut;
+    const FramePack::Dataset *packed = nullptr;
+    hid_t dsetId = -1; // borrowed from m_handles
+    hid_t fileSpace = -1;
+  };
+  std::vector<Panel> m_panels; // empty = the current dataset alone
+  int m_splitColumns = 1;
+
+  // persistent normalization cache + its low-priority thread
+  NormalizationCache *m_normCache = nullptr;
+  QThread *m_normThread = nullptr;
+  QString m_normDirectory;
+
+  // frame packs: written on their own low-priority thread, mapped here
+  FramePackWriter *m_packWriter = nullptr;
+  QThread *m_packThread = nullptr;
+  FramePack m_pack;
+  const FramePack::Dataset *m_packed = nullptr; // current dataset, if packed
+  std::atomic<bool> m_framePacks{false};
+
+  // volume dims; m_xres/m_yres are the (possibly decimated) output dims
   int m_nFrames = 0, m_xres = 0, m_yres = 0;
+  int m_fullXres = 0, m_fullYres = 0;
+
+  // display-resolution reads
+  QSize m_targetSize; // empty = read full resolution
+  bool m_decimate = true;
+  int m_decimationBlock = 2;
+  int m_step = 1;  // read every m_step-th pixel...
+  int m_block = 1; // ...averaging an m_block x m_block box there
+
+  // output size: the decimated slice is resampled to fit m_targetSize.
+  // Slices are m_xres rows of m_yres samples throughout, so the image is
+  // m_outYres wide and m_outXres high
+  struct ResampleTable {
+    std::vector<int> x0, x1, y0, y1;
+    std::vector<float> wx, wy;
+  };
+  bool m_scaleToTarget = true;
+  int m_outXres = 0, m_outYres = 0;
+  ResampleTable m_resample;
+
+  // progressive scrubbing; latencies are measured from the loader seeing
+  // the jump / the knob stopping to the frame leaving frameReady
+  bool m_scrubbing = false;
+  int m_scrubFactor = 4;
+  bool m_awaitFirstPixels = false;
+  bool m_awaitFinal = false;
+  QElapsedTimer m_jumpClock;
+  QElapsedTimer m_stillClock;
+  int m_scrubJumps = 0;
+  qint64 m_firstPixelsMsTotal = 0;
+  qint64 m_firstPixelsMsMax = 0;
 
   // colormap
   const uint8_t (*m_cmap)[3] = nullptr;
   size_t m_cmap_size = 0;
   int m_colormapIdx = 0;
 
+  // stretch + colormap lookup table; rebuilt only when its inputs change
+  ColormapLut m_lut;
+  int m_lutEntries = 16384;
+
+  // best SIMD kernels for this CPU, render ones per IndexDomain
+  std::array<RenderRowFn, kIndexDomains> m_renderRow;
+  ResampleRowFn m_resampleRow;
+
+  // tile-parallel colormap pass
+  QThreadPool m_renderPool;
+  int m_renderThreads = 1;
+  std::atomic<qint64> m_lastRenderNs{0};
+
   // rotation state
   int m_currentRotationFrame = 0;
   int m_fps = 25;
-  QTimer *m_timer = nullptr;
+  QTimer *m_timer = nullptr; // single shot, armed by m_scheduler
+  FrameScheduler m_scheduler;
+
+  // render demand: the clock only runs while a consumer is visible
+  bool m_demanded = false;
+  QElapsedTimer m_pauseClock; // paused with a volume loaded; else invalid
+  std::atomic<quint64> m_rendersAvoided{0};
 
-  // buffers
+  // buffers; every rendered QImage is a recycled m_framePool buffer that
+  // is handed to the UI by reference count, and m_frameCache holds on to
+  // them within the pool's cap (see sizeFramePool())
   std::vector<float> m_buf;
   QImage m_img;
+  std::shared_ptr<FramePool> m_framePool = FramePool::create();
+
+  // read-ahead ring; m_stateMutex guards the HDF5 handles, dims,
+  // normalization and colormap, which the prefetch thread reads
+  FrameRing m_ring{16};
+  FrameCache m_frameCache;
+  QThread *m_prefetchThread = nullptr;
+  QMutex m_stateMutex;
+  QWaitCondition m_stateChanged;
+  int m_generation = 0;
+  int m_prefetchCursor = 0;
+  int m_statsTicks = 0;
+
+  // whole-volume preload (guarded by m_stateMutex)
+  PageBuffer m_volume;
+  MappedFile m_mapped; // raw data of a contiguous dataset, if mapped
+  bool m_mappedReads = true;
+
+  // parallel decode of compressed chunks (see ChunkDecoder)
+  ChunkDecoder m_decoder;
+  bool m_parallelDecode = true;
+  QString m_lastPipeline;
+  qint64 m_preloadLimitBytes = qint64(512) * 1024 * 1024;
+  bool m_preloadPending = false;
+  QElapsedTimer m_loadClock; // time since the current file was opened
+
+  // a preload runs without m_stateMutex, on a snapshot of the dataset; it
+  // is only installed if no other file or dataset was loaded meanwhile
+  struct VolumeRead {
+    hid_t dsetId = -1; // our own reference (H5Iinc_ref)
+    int loadGeneration = 0;
+    int fileNumber = -1;
+    QString datasetKey;
+    int frames = 0, xres = 0, yres = 0;
+  };
+  std::atomic<int> m_loadGeneration{0}; // bumped by every loadFile()
 
   // Current step and age values
   int m_currentStep = 0;
@@ -1,4 +1,5 @@
 #include "ScaledPixmapLabel.h"
+#include "StageTimings.h"
 #include <QPaintEvent>
 #include <QPainter>
 
@@ -11,10 +12,39 @@ ScaledPixmapLabel::ScaledPixmapLabel(QWidget *parent) : QLabel(parent) {
 
 void ScaledPixmapLabel::setPixmapKeepingAspect(const QPixmap &pixmap) {
   m_original = pixmap;
+  m_image = QImage();
   update(); // schedule a repaint
 }
 
+void ScaledPixmapLabel::setImageKeepingAspect(const QImage &image) {
+  m_image = image; // shares the buffer, releasing the previous frame's
+  m_imageSetNs = StageTimings::now();
+  m_original = QPixmap();
+  update();
+}
+
 void ScaledPixmapLabel::paintEvent(QPaintEvent *ev) {
+  if (!m_image.isNull()) {
+    StageTimer timer(StageTimings::Paint);
+    QPainter painter(this);
+
+    // frames normally arrive at our (physical) size already, making this a
+    // plain blit; only right after a resize do we scale, centered, keeping
+    // the aspect ratio
+    QRect target(QPoint(0, 0),
+                 m_image.size().scaled(size(), Qt::KeepAspectRatio));
+    target.moveCenter(rect().center());
+    if (target.size() * devicePixelRatioF() != m_image.size())
+      painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(target, m_image);
+    if (m_imageSetNs >= 0) {
+      stageTimings().record(StageTimings::Present,
+                            StageTimings::now() - m_imageSetNs);
+      m_imageSetNs = -1;
+    }
+    return;
+  }
+
   if (m_original.isNull()) {
     QLabel::paintEvent(ev);
     return;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QImage>
 #include <QLabel>
 #include <QPixmap>
 
@@ -12,10 +13,16 @@ public:
   // Call this to set the image; it will be repainted at the right size
   void setPixmapKeepingAspect(const QPixmap &pixmap);
 
+  // Same for a frame that changes every tick: the image is drawn scaled
+  // straight from its buffer, without a pixmap conversion or scaled copy
+  void setImageKeepingAspect(const QImage &image);
+
 protected:
   // Override paintEvent to draw the scaled pixmap centered
   void paintEvent(QPaintEvent *ev) override;
 
 private:
   QPixmap m_original;
+  QImage m_image;
+  qint64 m_imageSetNs = -1; // StageTimings::now() of a frame not yet painted
 };
@@ -0,0 +1,116 @@
+// StageTimings.cpp
+#include "StageTimings.h"
+#include <QDateTime>
+#include <QFile>
+#include <QSysInfo>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+StageTimings &stageTimings() {
+  static StageTimings timings;
+  return timings;
+}
+
+const char *StageTimings::name(Stage stage) {
+  switch (stage) {
+  case Read:
+    return "read";
+  case Normalize:
+    return "normalize";
+  case Colormap:
+    return "colormap";
+  case Render:
+    return "render";
+  case Deliver:
+    return "deliver";
+  case Present:
+    return "present";
+  case Paint:
+    return "paint";
+  }
+  return "?";
+}
+
+qint64 StageTimings::now() {
+  static const QElapsedTimer clock = [] {
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+  }();
+  return clock.nsecsElapsed();
+}
+
+void StageTimings::record(Stage stage, qint64 ns) {
+  Window &window = m_windows[size_t(stage)];
+  quint64 slot = window.recorded.fetch_add(1, std::memory_order_relaxed);
+  window.ns[slot % kWindow].store(ns, std::memory_order_relaxed);
+}
+
+StageTimings::Summary StageTimings::summary(Stage stage) const {
+  const Window &window = m_windows[size_t(stage)];
+  Summary result;
+  result.samples = window.recorded.load(std::memory_order_relaxed);
+  const size_t count = size_t(std::min<quint64>(result.samples, kWindow));
+  if (count == 0)
+    return result;
+
+  // a racing writer can only swap in a newer sample, which is fine here
+  std::vector<qint64> samples(count);
+  for (size_t i = 0; i < count; ++i)
+    samples[i] = window.ns[i].load(std::memory_order_relaxed);
+  std::sort(samples.begin(), samples.end());
+
+  // nearest rank
+  auto percentile = [&](double p) {
+    size_t rank = size_t(std::ceil(p / 100.0 * double(count)));
+    return samples[std::clamp<size_t>(rank, 1, count) - 1] / 1e6;
+  };
+  result.p50Ms = percentile(50.0);
+  result.p95Ms = percentile(95.0);
+  result.p99Ms = percentile(99.0);
+  result.maxMs = samples.back() / 1e6;
+  return result;
+}
+
+QString StageTimings::table() const {
+  QString text = QString("%1 %2 %3 %4 %5\n")
+                     .arg(QString("stage (ms)"), -10)
+                     .arg(QString("p50"), 7)
+                     .arg(QString("p95"), 7)
+                     .arg(QString("p99"), 7)
+                     .arg(QString("max"), 7);
+  for (int i = 0; i < kStageCount; ++i) {
+    const Summary s = summary(Stage(i));
+    text += QString("%1 %2 %3 %4 %5\n")
+                .arg(QString::fromLatin1(name(Stage(i))), -10)
+                .arg(s.p50Ms, 7, 'f', 2)
+                .arg(s.p95Ms, 7, 'f', 2)
+                .arg(s.p99Ms, 7, 'f', 2)
+                .arg(s.maxMs, 7, 'f', 2);
+  }
+  text.chop(1);
+  return text;
+}
+
+bool StageTimings::appendCsv(const QString &path) const {
+  QFile file(path);
+  const bool fresh = !file.exists() || file.size() == 0;
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    return false;
+
+  QTextStream out(&file);
+  if (fresh)
+    out << "timestamp,host,stage,samples,p50_ms,p95_ms,p99_ms,max_ms\n";
+  const QString timestamp =
+      QDateTime::currentDateTime().toString(Qt::ISODate);
+  const QString host = QSysInfo::machineHostName();
+  for (int i = 0; i < kStageCount; ++i) {
+    const Summary s = summary(Stage(i));
+    out << timestamp << ',' << host << ',' << name(Stage(i)) << ','
+        << s.samples << ',' << s.p50Ms << ',' << s.p95Ms << ',' << s.p99Ms
+        << ',' << s.maxMs << '\n';
+  }
+  return out.status() == QTextStream::Ok;
+}
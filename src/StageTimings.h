@@ -0,0 +1,90 @@
+// StageTimings.h
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+
+/**
+ * @brief Rolling per-stage latencies of the visualisation pipeline.
+ *
+ * Each stage keeps its last kWindow samples in a lock-free ring, so
+ * recording costs one clock read and two relaxed atomic stores and can be
+ * done from any thread (loader, prefetch, GUI).  Percentiles are worked out
+ * from a copy of the window only when somebody asks: the on-screen overlay,
+ * the periodic log, or the CSV written on exit.
+ *
+ * Stages, in pipeline order:
+ *   • read       slice read (HDF5, pack decode, mapped / preloaded volume)
+ *   • normalize  percentile bounds of the latest file, when not cached
+ *   • colormap   stretch + colormap pass of one frame
+ *   • render     a whole renderFrame (read, normalize, colormap)
+ *   • deliver    frameReady emitted → slot running on the GUI thread
+ *   • present    frame handed to the label → first painted
+ *   • paint      ScaledPixmapLabel::paintEvent
+ */
+class StageTimings {
+public:
+  enum Stage { Read, Normalize, Colormap, Render, Deliver, Present, Paint };
+  static constexpr int kStageCount = Paint + 1;
+
+  /// Samples per stage the percentiles are taken over.
+  static constexpr int kWindow = 512;
+
+  static const char *name(Stage stage);
+
+  /// Nanoseconds on a process-wide monotonic clock, for cross-thread spans.
+  static qint64 now();
+
+  void record(Stage stage, qint64 ns);
+
+  struct Summary {
+    quint64 samples = 0; ///< recorded since start, not just in the window
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0; ///< over the window
+  };
+  Summary summary(Stage stage) const;
+
+  /// A fixed-width table of every stage, for the overlay.
+  QString table() const;
+
+  /**
+   * @brief Appends one row per stage to the CSV at @p path.
+   *
+   * Rows carry a timestamp and the host name, so files from several kiosks
+   * (or runs) can simply be concatenated and compared.
+   */
+  bool appendCsv(const QString &path) const;
+
+private:
+  struct Window {
+    std::atomic<quint64> recorded{0};
+    std::array<std::atomic<qint64>, kWindow> ns{};
+  };
+  std::array<Window, kStageCount> m_windows;
+};
+
+/// The process-wide pipeline timings.
+StageTimings &stageTimings();
+
+/**
+ * @brief Records the lifetime of the scope as one @p stage sample.
+ */
+class StageTimer {
+public:
+  explicit StageTimer(StageTimings::Stage stage) : m_stage(stage) {
+    m_clock.start();
+  }
+  ~StageTimer() { stageTimings().record(m_stage, m_clock.nsecsElapsed()); }
+
+  StageTimer(const StageTimer &) = delete;
+  StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+  StageTimings::Stage m_stage;
+  QElapsedTimer m_clock;
+};
@@ -1,15 +1,16 @@
 #include "VizTabWidget.h"
 #include "RotationFrameLoader.h"
+#include "StageTimings.h"
 #include <QApplication>
 #include <QDir>
 #include <QFile>
 #include <QFileInfoList>
+#include <QFontDatabase>
 #include <QGraphicsOpacityEffect>
 #include <QHideEvent>
 #include <QInputDialog>
 #include <QKeyEvent>
 #include <QMetaObject>
-#include <QRegularExpression>
 #include <QShortcut>
 #include <QShowEvent>
 #include <QVBoxLayout>
@@ -32,6 +33,14 @@ VizTabWidget::VizTabWidget(QWidget *parent)
   m_titleLabel->setStyleSheet(
       "background: rgba(0,0,0,0);"); // or semi‐opaque if you like
 
+  // --- Pipeline timings overlay (hidden until toggled) ---
+  m_timingsLabel = new QLabel(this);
+  m_timingsLabel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  m_timingsLabel->setAttribute(Qt::WA_TransparentForMouseEvents);
+  m_timingsLabel->setStyleSheet(
+      "background: rgba(0,0,0,160); color: white; padding: 8px;");
+  m_timingsLabel->hide();
+
   // Layout
   auto *lay = new QVBoxLayout(this);
   lay->setContentsMargins(0, 0, 0, 0);
@@ -93,9 +102,9 @@ VizTabWidget::VizTabWidget(QWidget *parent)
   connect(m_loader, &RotationFrameLoader::ageChanged, m_counterBL,
           &StepCounterWidget::setStep, Qt::QueuedConnection);
 
-  // directory watcher
-  connect(&m_dirWatcher, &QFileSystemWatcher::directoryChanged, this,
-          &VizTabWidget::onImageDirectoryChanged);
+  // complete image files, as SWIFT finishes them
+  connect(&m_imageIndex, &ImageIndex::fileAdded, this,
+          &VizTabWidget::onImageFileAdded);
 
   // loader/thread setup
   m_loader->moveToThread(m_loaderThread);
@@ -103,6 +112,8 @@ VizTabWidget::VizTabWidget(QWidget *parent)
           &RotationFrameLoader::startLoading, Qt::QueuedConnection);
   connect(m_loader, &RotationFrameLoader::frameReady, this,
           &VizTabWidget::handleFrameReady, Qt::QueuedConnection);
+  // Delete the loader (and join its prefetch stage) when the thread ends
+  connect(m_loaderThread, &QThread::finished, m_loader, &QObject::deleteLater);
   m_loaderThread->start();
 
   // Debounce interval for knob manipulating the file number
@@ -112,6 +123,13 @@ VizTabWidget::VizTabWidget(QWidget *parent)
   connect(&m_debounceTimer, &QTimer::timeout, this,
           &VizTabWidget::applyPendingDelta);
 
+  // Refine to full quality once the knob has been still this long
+  constexpr int REFINE_MS = 200;
+  m_refineTimer.setSingleShot(true);
+  m_refineTimer.setInterval(REFINE_MS);
+  connect(&m_refineTimer, &QTimer::timeout, this,
+          &VizTabWidget::refineAfterScrub);
+
   // Idle timer setup (reset to latest after inactivity)
   constexpr int IDLE_MS = 60 * 1000;
   m_idleTimer.setSingleShot(true);
@@ -121,6 +139,12 @@ VizTabWidget::VizTabWidget(QWidget *parent)
   // Start idle countdown immediately
   m_idleTimer.start();
 
+  // Timings overlay refresh
+  constexpr int TIMINGS_MS = 500;
+  m_timingsTimer.setInterval(TIMINGS_MS);
+  connect(&m_timingsTimer, &QTimer::timeout, this,
+          &VizTabWidget::updateTimingsOverlay);
+
   // Make sure this widget gets focus and key events
   setFocusPolicy(Qt::StrongFocus);
 }
@@ -129,37 +153,74 @@ VizTabWidget::~VizTabWidget() {
   // stop loader thread
   m_loaderThread->quit();
   m_loaderThread->wait();
+
+  // keep this kiosk's numbers for comparison with others
+  if (!m_timingsCsv.isEmpty()) {
+    if (stageTimings().appendCsv(m_timingsCsv))
+      qDebug() << "VizTabWidget: stage timings written to" << m_timingsCsv;
+    else
+      qWarning() << "VizTabWidget: cannot write" << m_timingsCsv;
+  }
+}
+
+void VizTabWidget::setHdf5PageBuffer(qint64 bytes) {
+  QMetaObject::invokeMethod(m_loader, "setPageBufferSize", Qt::QueuedConnection,
+                            Q_ARG(qint64, bytes));
+}
+
+void VizTabWidget::setStretch(const QString &datasetKey,
+                              const QString &stretch) {
+  QMetaObject::invokeMethod(m_loader, "setStretch", Qt::QueuedConnection,
+                            Q_ARG(QString, datasetKey),
+                            Q_ARG(QString, stretch));
+}
+
+void VizTabWidget::setScrubDecimation(int factor) {
+  QMetaObject::invokeMethod(m_loader, "setScrubDecimation",
+                            Qt::QueuedConnection, Q_ARG(int, factor));
+}
+
+void VizTabWidget::setFramePacks(bool enabled) {
+  // set before watchImageDirectory() queues the first transcodes
+  m_loader->setFramePacks(enabled);
 }
 
 void VizTabWidget::watchImageDirectory(const QString &dir) {
   m_imageDirectory = dir;
   if (!m_imageDirectory.endsWith('/'))
     m_imageDirectory += '/';
-  m_dirWatcher.removePaths(m_dirWatcher.directories());
-  if (QDir(m_imageDirectory).exists()) {
-    m_dirWatcher.addPath(m_imageDirectory);
-    scanImageDirectory();
+  m_imageIndex.setDirectory(
+      QDir(m_imageDirectory).exists() ? m_imageDirectory : QString());
+
+  // bin and pack the newest few files in the background before anyone
+  // asks; older ones are done when (if) somebody scrubs back to them
+  constexpr int STARTUP_BACKLOG = 3;
+  const QList<int> files = m_imageIndex.files();
+  for (qsizetype i = std::max<qsizetype>(0, files.size() - STARTUP_BACKLOG);
+       i < files.size(); ++i) {
+    if (files[i] <= m_latestFileNumber)
+      continue;
+    m_loader->precomputeNormalization(files[i]);
+    m_loader->transcodeFramePack(files[i]);
   }
+  setLatestFileNumber(m_imageIndex.latest());
 }
 
-void VizTabWidget::scanImageDirectory() {
-  if (m_imageDirectory.isEmpty())
+void VizTabWidget::onImageFileAdded(int fileNumber) {
+  m_loader->precomputeNormalization(fileNumber);
+  m_loader->transcodeFramePack(fileNumber);
+  setLatestFileNumber(fileNumber);
+}
+
+void VizTabWidget::setLatestFileNumber(int fileNumber) {
+  if (fileNumber <= m_latestFileNumber)
     return;
-  QDir d(m_imageDirectory);
-  QStringList files = d.entryList({"*.hdf5"}, QDir::Files, QDir::Name);
-  static const QRegularExpression re(R"(_(\d+)\.hdf5$)");
-  int maxIdx = m_latestFileNumber;
-  for (auto &fn : files) {
-    auto m = re.match(fn);
-    if (m.hasMatch()) {
-      int idx = m.captured(1).toInt();
-      maxIdx = std::max(maxIdx, idx);
-    }
-  }
-  if (maxIdx > m_latestFileNumber) {
-    m_latestFileNumber = maxIdx;
-    m_loader->setLatestFileNumber(m_latestFileNumber);
-  }
+  m_latestFileNumber = fileNumber;
+  m_loader->setLatestFileNumber(m_latestFileNumber);
+
+  // ...and open the newest, so moving to it does not stall the rotation
+  QMetaObject::invokeMethod(m_loader, "prewarmFile", Qt::QueuedConnection,
+                            Q_ARG(int, m_latestFileNumber));
 }
 
 void VizTabWidget::setCurrentFileNumber(int idx) {
@@ -179,6 +240,14 @@ void VizTabWidget::setCurrentFileNumberKnob(int idx) {
 
   m_currentFileNumber = idx;
 
+  // Coarse frames until the knob settles
+  if (!m_scrubbing) {
+    m_scrubbing = true;
+    QMetaObject::invokeMethod(m_loader, "setScrubbing", Qt::QueuedConnection,
+                              Q_ARG(bool, true));
+  }
+  m_refineTimer.start();
+
   // Simply swap files under the continuing rotation clock:
   QMetaObject::invokeMethod(m_loader, "jumpToFile", Qt::QueuedConnection,
                             Q_ARG(int, m_currentFileNumber),
@@ -190,22 +259,9 @@ void VizTabWidget::setDatasetKey(const QString &key) {
   if (key == m_currentDatasetKey)
     return;
   m_currentDatasetKey = key;
-  if (key == "dark_matter") {
-    m_colormap = Colormap::Copper;
-    setTitle(tr("Dark Matter"));
-  } else if (key == "gas") {
-    m_colormap = Colormap::Cosmic;
-    setTitle(tr("Gas"));
-  } else if (key == "stars") {
-    m_colormap = Colormap::SpeakNow;
-    setTitle(tr("Stars"));
-  } else if (key == "gas_temperature") {
-    m_colormap = Colormap::Inferno;
-    setTitle(tr("Temperature"));
-  } else {
-    m_colormap = Colormap::Viridis;
-    setTitle(tr("Unknown Dataset"));
-  }
+  m_colormap = datasetColormap(key);
+  if (m_splitColumns == 0)
+    setTitle(datasetTitle(key));
 
   // restart loader with new dataset
   if (m_currentFileNumber >= 0) {
@@ -214,13 +270,82 @@ void VizTabWidget::setDatasetKey(const QString &key) {
   }
 }
 
+VizTabWidget::Colormap VizTabWidget::datasetColormap(const QString &key) {
+  if (key == "dark_matter")
+    return Colormap::Copper;
+  if (key == "gas")
+    return Colormap::Cosmic;
+  if (key == "stars")
+    return Colormap::SpeakNow;
+  if (key == "gas_temperature")
+    return Colormap::Inferno;
+  return Colormap::Viridis;
+}
+
+QString VizTabWidget::datasetTitle(const QString &key) {
+  if (key == "dark_matter")
+    return tr("Dark Matter");
+  if (key == "gas")
+    return tr("Gas");
+  if (key == "stars")
+    return tr("Stars");
+  if (key == "gas_temperature")
+    return tr("Temperature");
+  return tr("Unknown Dataset");
+}
+
+void VizTabWidget::setSplitView(int columns) {
+  m_splitColumns = std::max(columns, 0);
+
+  // one file, one clock: the loader draws every panel into the same frame
+  QStringList keys;
+  QList<int> colormaps;
+  QStringList titles;
+  if (m_splitColumns > 0) {
+    for (const char *key : {"dark_matter", "gas", "stars", "gas_temperature"}) {
+      keys << key;
+      colormaps << int(datasetColormap(key));
+      titles << datasetTitle(key);
+    }
+  }
+  setTitle(m_splitColumns > 0 ? titles.join("  |  ")
+                              : datasetTitle(m_currentDatasetKey));
+  QMetaObject::invokeMethod(m_loader, "setSplitView", Qt::QueuedConnection,
+                            Q_ARG(QStringList, keys),
+                            Q_ARG(QList<int>, colormaps),
+                            Q_ARG(int, m_splitColumns));
+}
+
+void VizTabWidget::toggleSplitView(int columns) {
+  setSplitView(m_splitColumns == columns ? 0 : columns);
+}
+
+void VizTabWidget::toggleTimingsOverlay() {
+  if (m_timingsLabel->isVisible()) {
+    m_timingsTimer.stop();
+    m_timingsLabel->hide();
+    return;
+  }
+  updateTimingsOverlay();
+  m_timingsLabel->show();
+  m_timingsLabel->raise();
+  m_timingsTimer.start();
+}
+
+void VizTabWidget::updateTimingsOverlay() {
+  m_timingsLabel->setText(stageTimings().table());
+  m_timingsLabel->adjustSize();
+}
+
 void VizTabWidget::setPercentileRange(float low, float high) {
   m_percentileLow = std::clamp(low, 0.0f, 100.0f);
   m_percentileHigh = std::clamp(high, 0.0f, 100.0f);
-  if (m_currentFileNumber >= 0) {
-    emit startLoader(m_imageDirectory, m_currentFileNumber, m_currentDatasetKey,
-                     int(m_colormap), m_fps, false);
-  }
+
+  // The loader answers this from its cached histograms, no reload needed
+  QMetaObject::invokeMethod(m_loader, "setPercentileRange",
+                            Qt::QueuedConnection,
+                            Q_ARG(float, m_percentileLow),
+                            Q_ARG(float, m_percentileHigh));
 }
 
 void VizTabWidget::percentileRange(float &low, float &high) const {
@@ -245,9 +370,13 @@ void VizTabWidget::keyPressEvent(QKeyEvent *evt) {
 }
 
 void VizTabWidget::handleFrameReady(const QImage &img, int fileNumber,
-                                    int frameIndex, int totalFrames) {
-  // paint
-  m_imageLabel->setPixmapKeepingAspect(QPixmap::fromImage(img));
+                                    int frameIndex, int totalFrames,
+                                    qint64 emittedNs) {
+  stageTimings().record(StageTimings::Deliver,
+                        StageTimings::now() - emittedNs);
+
+  // paint straight from the loader's buffer
+  m_imageLabel->setImageKeepingAspect(img);
 }
 
 // In VizTabWidget.cpp
@@ -264,6 +393,15 @@ void VizTabWidget::resizeEvent(QResizeEvent *ev) {
   //                            w - leftMargin - rightMargin, h);
   m_titleLabel->raise();
 
+  // timings overlay sits top-left, under the title
+  m_timingsLabel->move(m_counterMargin, topMargin + h + 10);
+
+  // have the loader read only what we can show (physical pixels)
+  QSize target(qRound(width() * devicePixelRatioF()),
+               qRound(height() * devicePixelRatioF()));
+  QMetaObject::invokeMethod(m_loader, "setTargetSize", Qt::QueuedConnection,
+                            Q_ARG(QSize, target));
+
   // These are turned off for now, in favour of logos on walls around the
   // exhibit
 
@@ -344,10 +482,6 @@ void VizTabWidget::resizeEvent(QResizeEvent *ev) {
   m_counterBR->move(xBR, yBR);
 }
 
-void VizTabWidget::onImageDirectoryChanged(const QString &) {
-  scanImageDirectory();
-}
-
 void VizTabWidget::setTitle(const QString &text) {
   m_titleLabel->setText(text);
 }
@@ -390,6 +524,19 @@ void VizTabWidget::applyPendingDelta() {
   m_pendingDelta = 0;
 }
 
+void VizTabWidget::refineAfterScrub() {
+  if (!m_scrubbing)
+    return;
+  m_scrubbing = false;
+  QMetaObject::invokeMethod(m_loader, "setScrubbing", Qt::QueuedConnection,
+                            Q_ARG(bool, false));
+}
+
+void VizTabWidget::setRenderDemand(bool demanded) {
+  QMetaObject::invokeMethod(m_loader, "setRenderDemand", Qt::QueuedConnection,
+                            Q_ARG(bool, demanded));
+}
+
 void VizTabWidget::resetIdleTimer() { m_idleTimer.start(); }
 
 void VizTabWidget::resetToLatest() {
@@ -430,6 +577,7 @@ void VizTabWidget::promptHighPercentile() {
 
 void VizTabWidget::showEvent(QShowEvent *ev) {
   QWidget::showEvent(ev);
+  setRenderDemand(true);
   if (m_serialHandler) {
     connect(m_serialHandler, &SerialHandler::rotatedCW, this,
             &VizTabWidget::fastForwardTime);
@@ -440,6 +588,7 @@ void VizTabWidget::showEvent(QShowEvent *ev) {
 
 void VizTabWidget::hideEvent(QHideEvent *ev) {
   QWidget::hideEvent(ev);
+  setRenderDemand(false);
   if (m_serialHandler) {
     disconnect(m_serialHandler, &SerialHandler::rotatedCW, this,
                &VizTabWidget::fastForwardTime);
@@ -1,11 +1,11 @@
 #pragma once
 
+#include "ImageIndex.h"
 #include "RotationFrameLoader.h"
 #include "ScaledPixmapLabel.h"
 #include "SerialHandler.h"
 #include "StepCounter.h"
 #include "colormaps.h"
-#include <QFileSystemWatcher>
 #include <QImage>
 #include <QLabel>
 #include <QString>
@@ -37,18 +37,46 @@ public:
   /// Set the title of the visualization tab
   void setTitle(const QString &title);
 
+  /// HDF5 page buffer for each image file, in bytes (0 = off).
+  void setHdf5PageBuffer(qint64 bytes);
+
+  /// Extra read decimation while the knob moves (1 = always full quality).
+  void setScrubDecimation(int factor);
+
+  /// Rotate from uint16 frame packs, writing them for new files (off by
+  /// default; the displayed values are then log-quantized).
+  void setFramePacks(bool enabled);
+
+  /// Stretch curve for one dataset, e.g. "log" or "power:0.5".
+  void setStretch(const QString &datasetKey, const QString &stretch);
+
+  /// CSV the pipeline stage timings are appended to on exit ("" = none).
+  void setTimingsCsv(const QString &path) { m_timingsCsv = path; }
+
   /// Set the serial handler to allow scrolling time via serial commands.
   void setSerialHandler(SerialHandler *serialHandler) {
     m_serialHandler = serialHandler;
   }
 
 public slots:
-  /// Watch a directory of files named ".../image_<N>.hdf5"
+  /// Watch a directory of files named ".../image_<N>.hdf5" (see ImageIndex)
   void watchImageDirectory(const QString &directory);
 
   /// Manually switch dataset key (1–4)
   void setDatasetKey(const QString &key);
 
+  /**
+   * @brief Show all four datasets at once, @p columns panels wide (2 for
+   * 2x2, 4 for 1x4); 0 goes back to the current dataset alone.
+   */
+  void setSplitView(int columns);
+
+  /// Split view @p columns wide, or back to one dataset if already so.
+  void toggleSplitView(int columns);
+
+  /// Show or hide the per-stage p50/p95/p99 overlay.
+  void toggleTimingsOverlay();
+
   /// Instruct loader to jump to a given file index (0…latest)
   void setCurrentFileNumber(int index);
 
@@ -91,21 +119,43 @@ signals:
 
 private slots:
   void handleFrameReady(const QImage &img, int fileNumber, int frameIndex,
-                        int totalFrames);
-  void onImageDirectoryChanged(const QString &path);
+                        int totalFrames, qint64 emittedNs);
+
+  /// Refreshes the pipeline timings overlay.
+  void updateTimingsOverlay();
+
+  /// SWIFT finished writing image_<fileNumber>.hdf5.
+  void onImageFileAdded(int fileNumber);
 
   /**
    * @brief Applies accumulated delta after debounce interval.
    */
   void applyPendingDelta();
 
+  /**
+   * @brief The knob has been still for a while: back to full quality.
+   */
+  void refineAfterScrub();
+
   /**
    * @brief Resets visualization to the latest frame after idle period.
    */
   void resetToLatest();
 
 private:
-  void scanImageDirectory();
+  /// Record a newer latest file and have the loader open it ahead.
+  void setLatestFileNumber(int fileNumber);
+
+  /**
+   * @brief Run the loader's clock only while the frames can be seen.
+   *
+   * Driven by show/hide events: switching pages, and the spontaneous ones
+   * the window system sends when the window is minimized or unmapped.
+   */
+  void setRenderDemand(bool demanded);
+
+  static Colormap datasetColormap(const QString &key);
+  static QString datasetTitle(const QString &key);
 
   ScaledPixmapLabel *m_imageLabel;
   QLabel *m_logoLabel;
@@ -117,7 +167,8 @@ private:
   QLabel *m_esaLabel;
   QPixmap m_esaOrig;
   QLabel *m_titleLabel;
-  QFileSystemWatcher m_dirWatcher;
+  QLabel *m_timingsLabel;
+  ImageIndex m_imageIndex;
 
   // Logo offsets for centering
   int m_swiftXMargin = 15;
@@ -154,6 +205,9 @@ private:
   // colormap
   Colormap m_colormap = Colormap::Copper;
 
+  // split view grid width (0 = single dataset)
+  int m_splitColumns = 0;
+
   // pending time delta for rewinding/fast-forwarding and debouncing timer
   double m_pendingDelta = 0;
   QTimer m_debounceTimer;
@@ -161,9 +215,17 @@ private:
   double m_tickRemainder = 0; // Remaining fractional logical ticks
   SerialHandler *m_serialHandler = nullptr; // Serial handler for time control
 
+  // progressive rendering: coarse while scrubbing, refine when still
+  QTimer m_refineTimer;
+  bool m_scrubbing = false;
+
   // idle reset timer
   QTimer m_idleTimer;
 
+  // pipeline stage timings overlay, refreshed while shown
+  QTimer m_timingsTimer;
+  QString m_timingsCsv;
+
   // Step counters in bottom corners
   StepCounterWidget *m_counterBL;
   StepCounterWidget *m_counterBR;
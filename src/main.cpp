@@ -2,7 +2,9 @@
 
 #include "CommandLineParser.h"
 #include "DataWatcher.h"
+#include "Hdf5HandlePool.h"
 #include "MainView.h"
+#include "RenderKernels.h"
 
 #include "SimulationController.h"
 #include <QApplication>
@@ -30,6 +32,17 @@ int main(int argc, char **argv) {
   QString logFilePath = cli.logFilePath();
   QString paramsFilePath = cli.paramFilePath();
 
+  // Compare render kernels across exhibit PCs without starting SWIFT
+  if (cli.benchRender()) {
+    benchmarkRenderKernels();
+    return 0;
+  }
+  // ... and HDF5 layouts / chunk caches, to back the pool's cache sizing
+  if (cli.benchLayout()) {
+    benchmarkRotationLayouts();
+    return 0;
+  }
+
   std::cout << std::endl;
 
   // 2) Pass the simDir into your controller (add a ctor or setter)
@@ -0,0 +1,33 @@
+# CheckIsaSymbols.cmake
+#
+# Fails if an object compiled with SIMD flags defines a weak symbol other
+# than its own kernel instantiations.  Weak (COMDAT) definitions are merged
+# across objects at link time, so an inline helper emitted with -mavx2 here
+# could replace the portable copy every other caller uses.
+#
+#   cmake -DNM=<nm> -DOBJECTS=<obj>|<obj>... -P CheckIsaSymbols.cmake
+
+string(REPLACE "|" ";" objects "${OBJECTS}")
+set(failed FALSE)
+foreach(object IN LISTS objects)
+  execute_process(COMMAND ${NM} -C --defined-only ${object}
+                  OUTPUT_VARIABLE symbols RESULT_VARIABLE status)
+  if (NOT status EQUAL 0)
+    message(FATAL_ERROR "cannot read symbols of ${object}")
+  endif()
+  string(REPLACE "\n" ";" symbols "${symbols}")
+  foreach(line IN LISTS symbols)
+    # weak, weak object or GNU unique definitions
+    if (line MATCHES "^[0-9a-fA-F]* [WVu] (.*)$")
+      set(name "${CMAKE_MATCH_1}")
+      if (NOT name MATCHES "renderRow(Sse42|Avx2|Avx512)<")
+        message(SEND_ERROR "${object}: shared definition of ${name}")
+        set(failed TRUE)
+      endif()
+    endif()
+  endforeach()
+endforeach()
+if (failed)
+  message(FATAL_ERROR "ISA-flagged render kernels export shared code")
+endif()
+message(STATUS "ISA-flagged render kernels keep their helpers private")
@@ -0,0 +1,126 @@
+// FramePoolTest.cpp
+#include "FrameCache.h"
+#include "FramePool.h"
+#include <QDebug>
+#include <deque>
+
+/**
+ * @brief Checks that rendering stops allocating once the pool is full.
+ *
+ * Drives a FramePool and a FrameCache wired as RotationFrameLoader wires
+ * them (shared budget, cache eviction as the reclaimer) through rotations
+ * of more frames than the cache holds, with a read-ahead ring and a frame
+ * on screen holding buffers too, and the cache cleared between rotations
+ * as a normalization change does.  After the first rotation the
+ * allocation counter must not move.  Exits non-zero on any failure.
+ */
+
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+constexpr qint64 kFrameBytes = qint64(kWidth) * kHeight * 4;
+constexpr int kCachedFrames = 20;
+constexpr int kRing = 4;
+constexpr int kReserve = kRing + 4;
+constexpr int kRotationFrames = 50;
+
+struct Rig {
+  std::shared_ptr<FramePool> pool = FramePool::create();
+  FrameCache cache{kCachedFrames * kFrameBytes};
+  std::deque<QImage> ring;
+  QImage screen;
+
+  Rig() {
+    pool->setBudget(cache.budget(), kReserve);
+    pool->setReclaimer([this] { return cache.evictOldest(); });
+  }
+
+  /// One rotation; @p generation stands in for the normalization.
+  void rotate(int generation) {
+    for (int frame = 0; frame < kRotationFrames; ++frame) {
+      FrameKey key;
+      key.frameIndex = frame;
+      key.min = float(generation);
+      QImage image;
+      if (!cache.find(key, image)) {
+        image = pool->acquire(kWidth, kHeight);
+        image.fill(0xff000000u | uint(frame));
+        cache.insert(key, image);
+      }
+      ring.push_back(image);
+      if (int(ring.size()) > kRing)
+        ring.pop_front();
+      screen = ring.front();
+    }
+  }
+};
+
+int failures = 0;
+
+void expect(bool ok, const char *what) {
+  if (!ok) {
+    qWarning() << "FramePoolTest:" << what;
+    ++failures;
+  }
+}
+
+} // namespace
+
+int main() {
+  const int cap = kCachedFrames + kReserve;
+
+  // cache evictions alone: the rotation is longer than the cache
+  {
+    Rig rig;
+    rig.rotate(0);
+    const quint64 warm = rig.pool->allocated();
+    for (int i = 0; i < 3; ++i)
+      rig.rotate(0);
+    expect(rig.pool->allocated() == warm,
+           "allocations while the cache evicts");
+    expect(int(warm) <= cap, "allocated past the cap");
+    qDebug() << "FramePoolTest:" << warm << "buffers allocated, then"
+             << rig.pool->reused() << "reused";
+  }
+
+  // the cache cleared every rotation, as a normalization change does
+  {
+    Rig rig;
+    rig.rotate(0);
+    const quint64 warm = rig.pool->allocated();
+    for (int generation = 1; generation <= 3; ++generation) {
+      rig.cache.clear();
+      rig.rotate(generation);
+    }
+    expect(rig.pool->allocated() == warm,
+           "allocations after the cache was cleared");
+    expect(rig.pool->buffers() <= cap, "pool grew past the cap");
+  }
+
+  // a working set beyond the reserve, cache empty: allocate, don't stall
+  {
+    Rig rig;
+    rig.cache.setBudget(0);
+    rig.pool->setBudget(0, 2);
+    std::vector<QImage> held;
+    for (int i = 0; i < 6; ++i)
+      held.push_back(rig.pool->acquire(kWidth, kHeight));
+    expect(rig.pool->allocated() == 6, "working set not allocated");
+    held.clear();
+    expect(rig.pool->buffers() == 2, "idle buffers kept past the cap");
+  }
+
+  // a new output size drains the old buffers
+  {
+    Rig rig;
+    rig.rotate(0);
+    rig.ring.clear();
+    rig.screen = QImage();
+    rig.cache.clear();
+    QImage resized = rig.pool->acquire(kWidth / 2, kHeight / 2);
+    expect(rig.pool->buffers() == 1, "old size still counted");
+  }
+
+  return failures == 0 ? 0 : 1;
+}
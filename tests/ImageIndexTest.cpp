@@ -0,0 +1,127 @@
+// ImageIndexTest.cpp
+#include "ImageIndex.h"
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+#include <QTemporaryDir>
+
+/**
+ * @brief Checks ImageIndex::hasCompleteSuperblock() on synthetic files.
+ *
+ * Each file is a superblock as the HDF5 library lays it out (versions 0
+ * and 2, optionally behind a user block) padded to some size, so the cases
+ * a writer can leave on disk are spelled out byte for byte: closed, still
+ * flagged open, truncated (end-of-file address past the data) and stale
+ * (data past the end-of-file address).  Exits non-zero on any mismatch.
+ */
+
+namespace {
+
+const QByteArray kSignature("\x89HDF\r\n\x1a\n", 8);
+
+void putAddress(QByteArray &block, int at, quint64 value) {
+  for (int i = 0; i < 8; ++i)
+    block[at + i] = char((value >> (8 * i)) & 0xff);
+}
+
+/// Version 0 superblock, 8-byte addresses; @p base is the user block size.
+QByteArray superblockV0(quint64 base, quint64 eof) {
+  QByteArray block(24 + 4 * 8, '\0');
+  block.replace(0, 8, kSignature);
+  block[13] = 8; // size of offsets
+  block[14] = 8; // size of lengths
+  block[16] = 4; // group leaf node K
+  block[18] = 16;
+  putAddress(block, 24, base);
+  putAddress(block, 32, ~quint64(0)); // no free-space info
+  putAddress(block, 40, eof);
+  putAddress(block, 48, ~quint64(0)); // no driver info
+  return block;
+}
+
+/// Version 2 superblock with consistency @p flags.
+QByteArray superblockV2(quint64 eof, char flags) {
+  QByteArray block(12 + 4 * 8 + 4, '\0');
+  block.replace(0, 8, kSignature);
+  block[8] = 2;
+  block[9] = 8;
+  block[10] = 8;
+  block[11] = flags;
+  putAddress(block, 12, 0);
+  putAddress(block, 20, ~quint64(0)); // no extension
+  putAddress(block, 28, eof);
+  putAddress(block, 36, 96); // root group header
+  return block;
+}
+
+/// Writes @p userBlock zero bytes, @p superblock, then pads to @p size.
+bool writeFile(const QString &path, qint64 userBlock,
+               const QByteArray &superblock, qint64 size) {
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  QByteArray bytes(userBlock, '\0');
+  bytes += superblock;
+  bytes += QByteArray(size - bytes.size(), '\x2a');
+  return file.write(bytes) == bytes.size();
+}
+
+} // namespace
+
+int main() {
+  QTemporaryDir dir;
+  if (!dir.isValid()) {
+    qWarning() << "ImageIndexTest: no temporary directory";
+    return 1;
+  }
+
+  struct Case {
+    const char *name;
+    qint64 userBlock;
+    QByteArray superblock;
+    qint64 size;
+    bool complete;
+  };
+  const Case cases[] = {
+      {"v0 closed", 0, superblockV0(0, 8192), 8192, true},
+      {"v0 truncated", 0, superblockV0(0, 8192), 6000, false},
+      {"v0 stale end of file", 0, superblockV0(0, 8192), 12288, false},
+      {"v0 undefined end of file", 0, superblockV0(0, ~quint64(0)), 8192,
+       false},
+      {"v0 user block, library address", 512, superblockV0(512, 8704), 8704,
+       true},
+      {"v0 user block, relative address", 512, superblockV0(512, 8192), 8704,
+       true},
+      {"v0 user block, truncated", 512, superblockV0(512, 8704), 4096, false},
+      {"v2 closed", 0, superblockV2(8192, 0), 8192, true},
+      {"v2 open for writing", 0, superblockV2(8192, 0x01), 8192, false},
+      {"v2 open by a SWMR writer", 0, superblockV2(8192, 0x04), 8192, false},
+      {"v2 truncated", 0, superblockV2(8192, 0), 8000, false},
+      {"v2 stale end of file", 0, superblockV2(8192, 0), 9000, false},
+      {"no signature", 0, QByteArray(64, '\0'), 8192, false},
+  };
+
+  int failures = 0;
+  int n = 0;
+  for (const Case &c : cases) {
+    const QString path = dir.filePath(QString("image_%1.hdf5").arg(n++));
+    if (!writeFile(path, c.userBlock, c.superblock, c.size)) {
+      qWarning() << "ImageIndexTest: cannot write" << path;
+      return 1;
+    }
+    const bool complete = ImageIndex::hasCompleteSuperblock(path);
+    if (complete != c.complete) {
+      qWarning() << "ImageIndexTest:" << c.name << "taken as"
+                 << (complete ? "complete" : "incomplete");
+      ++failures;
+    }
+  }
+  if (ImageIndex::hasCompleteSuperblock(dir.filePath("missing.hdf5"))) {
+    qWarning() << "ImageIndexTest: a missing file taken as complete";
+    ++failures;
+  }
+
+  qDebug() << "ImageIndexTest:" << n - failures << "of" << n
+           << "superblock cases as expected";
+  return failures == 0 ? 0 : 1;
+}